@@ -0,0 +1,100 @@
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		std::atomic<bool> g_IsTracking{ false };
+		std::atomic<uint64_t> g_AllocationCount{};
+		std::atomic<uint64_t> g_AllocatedBytes{};
+
+		void CountAllocation(std::size_t size)
+		{
+			//A single relaxed load while disabled, the counters don't order anything
+			if (!g_IsTracking.load(std::memory_order_relaxed))
+				return;
+
+			g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+			g_AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		}
+
+		void* AllocateAligned(std::size_t size, std::size_t alignment)
+		{
+#if defined(_WIN32)
+			return _aligned_malloc(size, alignment);
+#else
+			//aligned_alloc wants a size that is a multiple of the alignment
+			return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+		}
+
+		void FreeAligned(void* pMemory)
+		{
+#if defined(_WIN32)
+			_aligned_free(pMemory);
+#else
+			std::free(pMemory);
+#endif
+		}
+	}
+
+	void Utils::SetAllocationTracking(bool isEnabled)
+	{
+		g_IsTracking.store(isEnabled, std::memory_order_relaxed);
+	}
+
+	bool Utils::IsAllocationTrackingEnabled()
+	{
+		return g_IsTracking.load(std::memory_order_relaxed);
+	}
+
+	AllocationCounters Utils::GetAllocationCounters()
+	{
+		return { g_AllocationCount.load(std::memory_order_relaxed), g_AllocatedBytes.load(std::memory_order_relaxed) };
+	}
+}
+
+//Replacements of the global allocation functions, the array and nothrow forms of the standard library forward to these
+void* operator new(std::size_t size)
+{
+	dae::CountAllocation(size);
+	if (void* pMemory{ std::malloc(size != 0 ? size : 1) })
+		return pMemory;
+	throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	dae::CountAllocation(size);
+	if (void* pMemory{ dae::AllocateAligned(size != 0 ? size : 1, static_cast<std::size_t>(alignment)) })
+		return pMemory;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+	dae::FreeAligned(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t, std::align_val_t) noexcept
+{
+	dae::FreeAligned(pMemory);
+}
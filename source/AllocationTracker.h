@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	struct AllocationCounters
+	{
+		uint64_t count{};
+		uint64_t bytes{};
+	};
+
+	namespace Utils
+	{
+		//The global operator new is replaced in AllocationTracker.cpp, while tracking is enabled it counts every call on every thread
+		//Allocations of C libraries (SDL, malloc) are not seen, only C++ ones
+		void SetAllocationTracking(bool isEnabled);
+		bool IsAllocationTrackingEnabled();
+		//Totals since tracking was first enabled, the difference of two snapshots is what happened in between
+		AllocationCounters GetAllocationCounters();
+	}
+}
@@ -40,6 +40,8 @@ namespace dae
 
 		float near{ 0.1f };
 		float far{ 100.f };
+		//Reversed-Z projection, near maps to depth 1 and far to 0
+		bool isDepthReversed{ false };
 
 		void Initialize(float _fovAngle = 90.f, Vector3 _origin = {0.f,0.f,0.f}, float _aspectRatio = 1)
 		{
@@ -77,7 +79,8 @@ namespace dae
 			//ProjectionMatrix => Matrix::CreatePerspectiveFovLH(...) [not implemented yet]
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixperspectivefovlh
 
-			projectionMatrix = Matrix::CreatePerspectiveFovLH(fov, aspectRatio, near, far);
+			projectionMatrix = isDepthReversed ? Matrix::CreatePerspectiveFovLHReversed(fov, aspectRatio, near, far)
+				: Matrix::CreatePerspectiveFovLH(fov, aspectRatio, near, far);
 			
 		}
 
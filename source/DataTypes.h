@@ -1,9 +1,12 @@
 #pragma once
 #include "Math.h"
 #include "vector"
+#include <cstdint>
 
 namespace dae
 {
+	class Texture;
+
 	struct Vertex
 	{
 		Vector3 position{};
@@ -24,19 +27,130 @@ namespace dae
 		Vector3 viewDirection{};
 	};
 
+	//Bit mask of the Vertex_Out attributes a pixel shader reads
+	//Attributes outside the mask are neither written by the vertex stage nor interpolated
+	namespace Varyings
+	{
+		enum : uint32_t
+		{
+			None = 0,
+			Color = 1 << 0,
+			UV = 1 << 1,
+			Normal = 1 << 2,
+			Tangent = 1 << 3,
+			ViewDirection = 1 << 4,
+			All = Color | UV | Normal | Tangent | ViewDirection
+		};
+	}
+
+	//Terms of the lighting model the pixel shader outputs
+	enum class ShadingMode
+	{
+		Combined,
+		ObservedArea,
+		Diffuse,
+		Specular
+	};
+
+	//Storage and comparison of the depth buffer of the vehicle path
+	enum class DepthFormat
+	{
+		Float32, //Standard-Z, closer is smaller
+		Float32Reversed, //Reversed-Z, closer is larger and the float precision near 0 goes to the far range where it is needed
+		Unorm24, //Standard-Z quantized to 24 bit, packed in 3 bytes
+		Unorm16 //Standard-Z quantized to 16 bit, enough for depth-only passes
+	};
+
+	//Where the 8 bit channels of a 32 bit surface go, resolved once so the shader packs colours without SDL_MapRGB
+	struct ColorFormat
+	{
+		int redShift{};
+		int greenShift{};
+		int blueShift{};
+		uint32_t alphaMask{};
+	};
+
 	enum class PrimitiveTopology
 	{
 		TriangleList,
 		TriangleStrip
 	};
 
+	//Quantized structure-of-arrays copy of Mesh::vertices, padded to a multiple of simd::MaxWidth
+	struct VertexStreams
+	{
+		size_t count{};
+		//16 bit unorm inside the mesh bounds, positionDecodeMatrix maps them back to object space
+		std::vector<uint16_t> positionX{}, positionY{}, positionZ{};
+		Matrix positionDecodeMatrix{};
+		//Octahedral encoded unit vectors, 16 bit snorm per component
+		std::vector<int16_t> normalX{}, normalY{};
+		std::vector<int16_t> tangentX{}, tangentY{};
+		//16 bit unorm inside the uv range of the mesh, uv = value * uvScale + uvOffset
+		std::vector<uint16_t> u{}, v{};
+		Vector2 uvScale{}, uvOffset{};
+	};
+
+	//Output of the SoA vertex stage, the streams live in the frame arena for one frame (Utils::AllocateVertexStreams)
+	struct VertexStreamsOut
+	{
+		float* positionX{};
+		float* positionY{};
+		float* positionZ{};
+		float* positionW{};
+		float* normalX{};
+		float* normalY{};
+		float* normalZ{};
+		float* tangentX{};
+		float* tangentY{};
+		float* tangentZ{};
+		float* viewDirectionX{};
+		float* viewDirectionY{};
+		float* viewDirectionZ{};
+	};
+
+	struct AABB
+	{
+		Vector3 minimum{};
+		Vector3 maximum{};
+	};
+
+	struct MeshLOD
+	{
+		std::vector<uint32_t> indices{};
+		uint32_t vertexCount{}; //Level only references vertices [0, vertexCount)
+		float geometricError{}; //Object space distance the simplification may be off by
+	};
+
 	struct Mesh
 	{
 		std::vector<Vertex> vertices{};
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleStrip };
 
-		std::vector<Vertex_Out> vertices_out{};
+		//Filled by Utils::BuildVertexStreams, used by the SIMD vertex stage
+		VertexStreams streams{};
+
+		//Filled by Utils::GenerateLODs, level 0 is the full mesh
+		std::vector<MeshLOD> lods{};
+		AABB bounds{};
+		Vector3 boundsCenter{};
+		float boundsRadius{};
+	};
+
+	struct Material
+	{
+		Texture* pDiffuse{};
+		Texture* pNormal{};
+		Texture* pGloss{};
+		Texture* pSpecular{};
+	};
+
+	//Placement of a shared Mesh in the scene, the geometry itself is never copied
+	struct MeshInstance
+	{
+		uint32_t meshIndex{};
+		uint32_t materialIndex{};
 		Matrix worldMatrix{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "FrameArena.h"
+
+#include <new>
+
+namespace dae
+{
+	FrameArena::FrameArena(size_t capacity) :
+		m_pBlock{ AllocateBlock(capacity) }
+		, m_Capacity{ capacity }
+	{
+	}
+
+	FrameArena::~FrameArena()
+	{
+		for (uint8_t* pBlock : m_OverflowBlocks)
+		{
+			FreeBlock(pBlock);
+		}
+		FreeBlock(m_pBlock);
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		const size_t offset{ (m_Offset + alignment - 1) & ~(alignment - 1) };
+		if (offset + size <= m_Capacity)
+		{
+			m_Offset = offset + size;
+			return m_pBlock + offset;
+		}
+
+		//Out of space for this frame, the allocation gets its own block and counts towards the size of the next one
+		uint8_t* pBlock{ AllocateBlock(size) };
+		m_OverflowBlocks.push_back(pBlock);
+		m_OverflowBytes += (size + BlockAlignment - 1) & ~(BlockAlignment - 1);
+		return pBlock;
+	}
+
+	void FrameArena::Reset()
+	{
+		m_Offset = 0;
+		if (m_OverflowBlocks.empty())
+			return;
+
+		for (uint8_t* pBlock : m_OverflowBlocks)
+		{
+			FreeBlock(pBlock);
+		}
+		m_OverflowBlocks.clear();
+
+		//One block that holds the whole of the last frame, with some room so a slowly growing frame doesn't regrow every time
+		const size_t capacity{ m_Capacity + m_OverflowBytes + m_OverflowBytes / 2 };
+		m_OverflowBytes = 0;
+
+		FreeBlock(m_pBlock);
+		m_pBlock = AllocateBlock(capacity);
+		m_Capacity = capacity;
+	}
+
+	uint8_t* FrameArena::AllocateBlock(size_t size)
+	{
+		return static_cast<uint8_t*>(::operator new(std::max(size, size_t{ 1 }), std::align_val_t{ BlockAlignment }));
+	}
+
+	void FrameArena::FreeBlock(uint8_t* pBlock)
+	{
+		::operator delete(pBlock, std::align_val_t{ BlockAlignment });
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace dae
+{
+	//Bump allocator for data that only lives during one frame, Reset hands everything back at once
+	//A frame that runs out of the block gets extra blocks, the next Reset replaces all of them by one block large enough,
+	//so once the frames stop growing the arena never touches the heap again
+	class FrameArena final
+	{
+	public:
+		//Blocks start at this alignment, enough for every SIMD width
+		static constexpr size_t BlockAlignment{ 64 };
+
+		explicit FrameArena(size_t capacity = size_t{ 1 } << 20);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) noexcept = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+		//Uninitialized memory for count objects, valid until the next Reset
+		//Nothing is ever destroyed, so only trivially destructible types are allowed
+		template<typename T>
+		T* Allocate(size_t count, size_t alignment = alignof(T))
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "The frame arena never runs destructors");
+			return static_cast<T*>(Allocate(count * sizeof(T), std::max(alignment, alignof(T))));
+		}
+		//alignment has to be a power of two no larger than BlockAlignment
+		void* Allocate(size_t size, size_t alignment);
+
+		//O(1) unless the last frame needed extra blocks
+		void Reset();
+
+		size_t GetUsedBytes() const { return m_Offset + m_OverflowBytes; }
+		size_t GetCapacity() const { return m_Capacity; }
+
+	private:
+		uint8_t* m_pBlock{};
+		size_t m_Capacity{};
+		size_t m_Offset{};
+
+		//Blocks allocated after m_pBlock ran out during this frame
+		std::vector<uint8_t*> m_OverflowBlocks{};
+		size_t m_OverflowBytes{};
+
+		static uint8_t* AllocateBlock(size_t size);
+		static void FreeBlock(uint8_t* pBlock);
+	};
+}
@@ -0,0 +1,98 @@
+#include "FramePresenter.h"
+
+#include "SDL.h"
+#include "SDL_surface.h"
+
+#include <algorithm>
+
+namespace dae
+{
+	FramePresenter::FramePresenter(SDL_Window* pWindow, int width, int height, uint32_t targetCount) :
+		m_pWindow{ pWindow }
+	{
+		//One to render in and one to present is the minimum
+		targetCount = std::max(targetCount, 2u);
+
+		m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
+
+		m_Targets.reserve(targetCount);
+		m_FreeTargets.reserve(targetCount);
+		m_QueuedTargets.reserve(targetCount);
+		for (uint32_t index{}; index < targetCount; ++index)
+		{
+			m_Targets.push_back(SDL_CreateRGBSurface(0, width, height, 32, 0, 0, 0, 0));
+			m_FreeTargets.push_back(index);
+		}
+
+		m_Thread = std::thread{ &FramePresenter::PresentLoop, this };
+	}
+
+	FramePresenter::~FramePresenter()
+	{
+		//The present thread still shows everything that was queued before it stops
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_QueuedCondition.notify_one();
+		m_Thread.join();
+
+		for (SDL_Surface* pTarget : m_Targets)
+		{
+			SDL_FreeSurface(pTarget);
+		}
+	}
+
+	uint32_t FramePresenter::AcquireTarget()
+	{
+		std::unique_lock lock{ m_Mutex };
+		m_FreeCondition.wait(lock, [this] { return !m_FreeTargets.empty(); });
+
+		const uint32_t index{ m_FreeTargets.back() };
+		m_FreeTargets.pop_back();
+		return index;
+	}
+
+	void FramePresenter::SubmitTarget(uint32_t index)
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_QueuedTargets.push_back(index);
+		}
+		m_QueuedCondition.notify_one();
+	}
+
+	void FramePresenter::WaitUntilPresented()
+	{
+		std::unique_lock lock{ m_Mutex };
+		m_FreeCondition.wait(lock, [this] { return m_QueuedTargets.empty() && !m_IsPresenting; });
+	}
+
+	void FramePresenter::PresentLoop()
+	{
+		while (true)
+		{
+			uint32_t index{};
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_QueuedCondition.wait(lock, [this] { return m_IsStopping || !m_QueuedTargets.empty(); });
+				if (m_QueuedTargets.empty())
+					return;
+
+				index = m_QueuedTargets.front();
+				m_QueuedTargets.erase(m_QueuedTargets.begin());
+				m_IsPresenting = true;
+			}
+
+			SDL_BlitSurface(m_Targets[index], nullptr, m_pFrontBuffer, nullptr);
+			SDL_UpdateWindowSurface(m_pWindow);
+
+			{
+				std::lock_guard lock{ m_Mutex };
+				m_FreeTargets.push_back(index);
+				m_IsPresenting = false;
+			}
+			m_FreeCondition.notify_all();
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SDL_Window;
+struct SDL_Surface;
+
+namespace dae
+{
+	//Owns the render targets and puts finished ones on screen from a thread of its own, so rendering never waits on the window system
+	//A target goes free -> rendering -> queued -> presented -> free, with 3 targets one frame renders while one waits and one is shown
+	class FramePresenter final
+	{
+	public:
+		FramePresenter(SDL_Window* pWindow, int width, int height, uint32_t targetCount = 3);
+		~FramePresenter();
+
+		FramePresenter(const FramePresenter&) = delete;
+		FramePresenter(FramePresenter&&) noexcept = delete;
+		FramePresenter& operator=(const FramePresenter&) = delete;
+		FramePresenter& operator=(FramePresenter&&) noexcept = delete;
+
+		//Index of a target the present thread doesn't read, only blocks while every other target is still queued
+		uint32_t AcquireTarget();
+		//Queues the rendered target, it becomes free again once it is on screen
+		void SubmitTarget(uint32_t index);
+		//Blocks until every submitted target is on screen
+		void WaitUntilPresented();
+
+		SDL_Surface* GetTarget(uint32_t index) const { return m_Targets[index]; }
+		uint32_t GetTargetCount() const { return static_cast<uint32_t>(m_Targets.size()); }
+
+	private:
+		SDL_Window* m_pWindow{};
+		SDL_Surface* m_pFrontBuffer{};
+		std::vector<SDL_Surface*> m_Targets{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_QueuedCondition{};
+		std::condition_variable m_FreeCondition{};
+		//Oldest first, reserved for every target so queueing never allocates
+		std::vector<uint32_t> m_QueuedTargets{};
+		std::vector<uint32_t> m_FreeTargets{};
+		bool m_IsPresenting{ false };
+		bool m_IsStopping{ false };
+
+		std::thread m_Thread{};
+
+		void PresentLoop();
+	};
+}
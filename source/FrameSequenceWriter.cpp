@@ -0,0 +1,226 @@
+#include "FrameSequenceWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace dae
+{
+	FrameSequenceWriter::FrameSequenceWriter(FrameSequenceFormat format, const std::string& path, int width, int height, const ColorFormat& colorFormat,
+		int frameRate, uint32_t bufferCount) :
+		m_Format{ format }
+		, m_Path{ path }
+		, m_Width{ width }
+		, m_Height{ height }
+		, m_ColorFormat{ colorFormat }
+	{
+		switch (m_Format)
+		{
+		case FrameSequenceFormat::Y4M:
+			m_File.open(m_Path, std::ios::binary);
+			//Progressive, square pixels and no chroma subsampling
+			m_File << "YUV4MPEG2 W" << m_Width << " H" << m_Height << " F" << frameRate << ":1 Ip A1:1 C444\n";
+			m_IsGood = m_File.good();
+			break;
+		case FrameSequenceFormat::RawRGB:
+#if defined(_WIN32)
+			//Text mode would turn every 0x0a byte into 0x0d 0x0a
+			_setmode(_fileno(stdout), _O_BINARY);
+#endif
+			break;
+		case FrameSequenceFormat::PPM:
+		default:
+			break;
+		}
+
+		bufferCount = std::max(bufferCount, 1u);
+		m_Buffers.assign(bufferCount, std::vector<uint32_t>(static_cast<size_t>(m_Width) * m_Height));
+		m_QueuedBuffers.reserve(bufferCount);
+		for (uint32_t index{}; index < bufferCount; ++index)
+		{
+			m_FreeBuffers.push_back(index);
+		}
+
+		m_Thread = std::thread{ &FrameSequenceWriter::WriterLoop, this };
+	}
+
+	FrameSequenceWriter::~FrameSequenceWriter()
+	{
+		//Every submitted frame still ends up in the output
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_QueuedCondition.notify_one();
+		m_Thread.join();
+
+		if (m_Format == FrameSequenceFormat::RawRGB)
+			std::cout.flush();
+	}
+
+	void FrameSequenceWriter::SubmitFrame(const uint32_t* pPixels)
+	{
+		uint32_t bufferIndex{};
+		{
+			std::unique_lock lock{ m_Mutex };
+			if (!m_IsGood)
+				return;
+
+			m_FreeCondition.wait(lock, [this] { return !m_FreeBuffers.empty(); });
+			bufferIndex = m_FreeBuffers.back();
+			m_FreeBuffers.pop_back();
+		}
+
+		//The copy is the only work the render thread does, the conversion runs on the writer thread
+		std::copy_n(pPixels, m_Buffers[bufferIndex].size(), m_Buffers[bufferIndex].data());
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_QueuedBuffers.push_back(bufferIndex);
+		}
+		m_QueuedCondition.notify_one();
+	}
+
+	void FrameSequenceWriter::WaitUntilWritten()
+	{
+		//A buffer only returns to the free ones after its frame is written
+		std::unique_lock lock{ m_Mutex };
+		m_FreeCondition.wait(lock, [this] { return m_FreeBuffers.size() == m_Buffers.size(); });
+	}
+
+	bool FrameSequenceWriter::IsGood() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_IsGood;
+	}
+
+	uint32_t FrameSequenceWriter::GetWrittenFrameCount() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_WrittenFrames;
+	}
+
+	bool FrameSequenceWriter::ParseFormat(const char* pName, FrameSequenceFormat& format)
+	{
+		if (!pName)
+			return false;
+
+		std::string name{ pName };
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char character) { return static_cast<char>(std::tolower(character)); });
+
+		if (name == "ppm")
+			format = FrameSequenceFormat::PPM;
+		else if (name == "y4m")
+			format = FrameSequenceFormat::Y4M;
+		else if (name == "raw" || name == "stdout")
+			format = FrameSequenceFormat::RawRGB;
+		else
+			return false;
+		return true;
+	}
+
+	void FrameSequenceWriter::WriterLoop()
+	{
+		uint32_t frameIndex{};
+		while (true)
+		{
+			uint32_t bufferIndex{};
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_QueuedCondition.wait(lock, [this] { return m_IsStopping || !m_QueuedBuffers.empty(); });
+				if (m_QueuedBuffers.empty())
+					return;
+
+				bufferIndex = m_QueuedBuffers.front();
+				m_QueuedBuffers.erase(m_QueuedBuffers.begin());
+			}
+
+			const bool isWritten{ WriteFrame(m_Buffers[bufferIndex], frameIndex++) };
+
+			{
+				std::lock_guard lock{ m_Mutex };
+				m_FreeBuffers.push_back(bufferIndex);
+				if (isWritten)
+					++m_WrittenFrames;
+				else
+					m_IsGood = false;
+			}
+			//Both a waiting SubmitFrame and WaitUntilWritten can be interested
+			m_FreeCondition.notify_all();
+		}
+	}
+
+	bool FrameSequenceWriter::WriteFrame(const std::vector<uint32_t>& pixels, uint32_t frameIndex)
+	{
+		switch (m_Format)
+		{
+		case FrameSequenceFormat::PPM:
+		{
+			ConvertToRGB(pixels);
+
+			char fileName[32]{};
+			std::snprintf(fileName, sizeof(fileName), "_%05u.ppm", frameIndex);
+			std::ofstream file{ m_Path + fileName, std::ios::binary };
+			file << "P6\n" << m_Width << ' ' << m_Height << "\n255\n";
+			file.write(reinterpret_cast<const char*>(m_ConvertedFrame.data()), m_ConvertedFrame.size());
+			return file.good();
+		}
+		case FrameSequenceFormat::Y4M:
+		{
+			ConvertToYUV(pixels);
+
+			m_File << "FRAME\n";
+			m_File.write(reinterpret_cast<const char*>(m_ConvertedFrame.data()), m_ConvertedFrame.size());
+			return m_File.good();
+		}
+		case FrameSequenceFormat::RawRGB:
+		default:
+		{
+			ConvertToRGB(pixels);
+
+			std::cout.write(reinterpret_cast<const char*>(m_ConvertedFrame.data()), m_ConvertedFrame.size());
+			return std::cout.good();
+		}
+		}
+	}
+
+	void FrameSequenceWriter::ConvertToRGB(const std::vector<uint32_t>& pixels)
+	{
+		m_ConvertedFrame.resize(pixels.size() * 3);
+
+		uint8_t* pOut{ m_ConvertedFrame.data() };
+		for (const uint32_t pixel : pixels)
+		{
+			*pOut++ = static_cast<uint8_t>(pixel >> m_ColorFormat.redShift);
+			*pOut++ = static_cast<uint8_t>(pixel >> m_ColorFormat.greenShift);
+			*pOut++ = static_cast<uint8_t>(pixel >> m_ColorFormat.blueShift);
+		}
+	}
+
+	void FrameSequenceWriter::ConvertToYUV(const std::vector<uint32_t>& pixels)
+	{
+		//Planar Y, Cb, Cr, BT.601 limited range since that is what players assume for Y4M
+		const size_t planeSize{ pixels.size() };
+		m_ConvertedFrame.resize(planeSize * 3);
+
+		uint8_t* pY{ m_ConvertedFrame.data() };
+		uint8_t* pCb{ pY + planeSize };
+		uint8_t* pCr{ pCb + planeSize };
+		for (size_t index{}; index < planeSize; ++index)
+		{
+			const int red{ static_cast<int>((pixels[index] >> m_ColorFormat.redShift) & 0xff) };
+			const int green{ static_cast<int>((pixels[index] >> m_ColorFormat.greenShift) & 0xff) };
+			const int blue{ static_cast<int>((pixels[index] >> m_ColorFormat.blueShift) & 0xff) };
+
+			pY[index] = static_cast<uint8_t>(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+			pCb[index] = static_cast<uint8_t>(((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128);
+			pCr[index] = static_cast<uint8_t>(((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128);
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	enum class FrameSequenceFormat
+	{
+		PPM, //One binary PPM per frame, <path>_00000.ppm, <path>_00001.ppm, ...
+		Y4M, //Single YUV4MPEG2 file with full resolution chroma (C444)
+		RawRGB //Packed 8 bit RGB frames on stdout, for piping into an external encoder, diagnostics go to Utils::GetLogStream
+	};
+
+	//Records rendered frames on a background thread so file I/O never runs on the render thread
+	//Frames are copied into a fixed pool of buffers, submitting only blocks when the writer is that many frames behind
+	class FrameSequenceWriter final
+	{
+	public:
+		//path is ignored for RawRGB, colorFormat is the channel layout of the submitted pixels
+		FrameSequenceWriter(FrameSequenceFormat format, const std::string& path, int width, int height, const ColorFormat& colorFormat,
+			int frameRate = 30, uint32_t bufferCount = 4);
+		~FrameSequenceWriter();
+
+		FrameSequenceWriter(const FrameSequenceWriter&) = delete;
+		FrameSequenceWriter(FrameSequenceWriter&&) noexcept = delete;
+		FrameSequenceWriter& operator=(const FrameSequenceWriter&) = delete;
+		FrameSequenceWriter& operator=(FrameSequenceWriter&&) noexcept = delete;
+
+		//Copies width * height pixels, the caller can reuse its buffer right away
+		void SubmitFrame(const uint32_t* pPixels);
+		//Blocks until every submitted frame is written
+		void WaitUntilWritten();
+
+		//False once opening or writing the output failed, later frames are dropped
+		bool IsGood() const;
+		uint32_t GetWrittenFrameCount() const;
+
+		static bool ParseFormat(const char* pName, FrameSequenceFormat& format);
+
+	private:
+		const FrameSequenceFormat m_Format;
+		const std::string m_Path;
+		const int m_Width;
+		const int m_Height;
+		const ColorFormat m_ColorFormat;
+
+		std::ofstream m_File{};
+		//Output of the writer thread only, converted pixels of one frame
+		std::vector<uint8_t> m_ConvertedFrame{};
+
+		//Every buffer is either free or queued, the writer thread takes one out of the queue while it converts it
+		std::vector<std::vector<uint32_t>> m_Buffers{};
+		std::vector<uint32_t> m_FreeBuffers{};
+		//Oldest first, reserved for every buffer so queueing never allocates
+		std::vector<uint32_t> m_QueuedBuffers{};
+
+		mutable std::mutex m_Mutex{};
+		std::condition_variable m_QueuedCondition{};
+		std::condition_variable m_FreeCondition{};
+		uint32_t m_WrittenFrames{};
+		bool m_IsGood{ true };
+		bool m_IsStopping{ false };
+
+		std::thread m_Thread{};
+
+		void WriterLoop();
+		bool WriteFrame(const std::vector<uint32_t>& pixels, uint32_t frameIndex);
+		void ConvertToRGB(const std::vector<uint32_t>& pixels);
+		void ConvertToYUV(const std::vector<uint32_t>& pixels);
+	};
+}
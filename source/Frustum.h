@@ -0,0 +1,86 @@
+#pragma once
+#include <algorithm>
+#include "DataTypes.h"
+
+namespace dae
+{
+	enum class FrustumTest
+	{
+		Outside,
+		Intersecting,
+		Inside
+	};
+
+	struct Frustum
+	{
+		//Plane equations (xyz = normal, w = distance), normals point into the frustum
+		Vector4 planes[6]{};
+
+		//Gribb/Hartmann extraction for row vectors (v * M) and [0,1] depth
+		static Frustum Extract(const Matrix& viewProjection)
+		{
+			auto column = [&viewProjection](int index)
+			{
+				return Vector4{ viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index] };
+			};
+
+			const Vector4 x{ column(0) };
+			const Vector4 y{ column(1) };
+			const Vector4 z{ column(2) };
+			const Vector4 w{ column(3) };
+
+			Frustum frustum{};
+			frustum.planes[0] = w + x; //Left
+			frustum.planes[1] = w - x; //Right
+			frustum.planes[2] = w + y; //Bottom
+			frustum.planes[3] = w - y; //Top
+			frustum.planes[4] = z;     //Near
+			frustum.planes[5] = w - z; //Far
+			return frustum;
+		}
+
+		FrustumTest Test(const AABB& box) const
+		{
+			FrustumTest result{ FrustumTest::Inside };
+			for (const Vector4& plane : planes)
+			{
+				//Corner furthest along the plane normal, if that one is behind the box is outside
+				const Vector3 positive{
+					plane.x >= 0.f ? box.maximum.x : box.minimum.x,
+					plane.y >= 0.f ? box.maximum.y : box.minimum.y,
+					plane.z >= 0.f ? box.maximum.z : box.minimum.z };
+				if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.f)
+					return FrustumTest::Outside;
+
+				const Vector3 negative{
+					plane.x >= 0.f ? box.minimum.x : box.maximum.x,
+					plane.y >= 0.f ? box.minimum.y : box.maximum.y,
+					plane.z >= 0.f ? box.minimum.z : box.maximum.z };
+				if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w < 0.f)
+					result = FrustumTest::Intersecting;
+			}
+			return result;
+		}
+	};
+
+	//Box around the 8 transformed corners, they go through the batch transform of Matrix together
+	inline AABB TransformAABB(const AABB& box, const Matrix& matrix)
+	{
+		const Vector3& low{ box.minimum };
+		const Vector3& high{ box.maximum };
+		Vector3 corners[8]
+		{
+			{ low.x, low.y, low.z }, { high.x, low.y, low.z }, { low.x, high.y, low.z }, { high.x, high.y, low.z },
+			{ low.x, low.y, high.z }, { high.x, low.y, high.z }, { low.x, high.y, high.z }, { high.x, high.y, high.z }
+		};
+		matrix.TransformPoints(corners, corners);
+
+		AABB result{ corners[0], corners[0] };
+		for (const Vector3& corner : corners)
+		{
+			result.minimum = { std::min(result.minimum.x, corner.x), std::min(result.minimum.y, corner.y), std::min(result.minimum.z, corner.z) };
+			result.maximum = { std::max(result.maximum.x, corner.x), std::max(result.maximum.y, corner.y), std::max(result.maximum.z, corner.z) };
+		}
+		return result;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace dae
+{
+	template<typename Signature>
+	class FunctionRef;
+
+	//Non-owning reference to a callable, for parameters that are only called before the function returns
+	//Unlike std::function it never allocates, whatever the lambda captures
+	template<typename Result, typename... Arguments>
+	class FunctionRef<Result(Arguments...)> final
+	{
+	public:
+		template<typename Function, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Function>, FunctionRef>>>
+		FunctionRef(Function&& function) :
+			m_pCallable{ const_cast<void*>(static_cast<const void*>(std::addressof(function))) }
+			, m_pInvoke{ [](void* pCallable, Arguments... arguments) -> Result
+				{
+					return (*static_cast<std::remove_reference_t<Function>*>(pCallable))(std::forward<Arguments>(arguments)...);
+				} }
+		{
+		}
+
+		Result operator()(Arguments... arguments) const
+		{
+			return m_pInvoke(m_pCallable, std::forward<Arguments>(arguments)...);
+		}
+
+	private:
+		void* m_pCallable;
+		Result(*m_pInvoke)(void*, Arguments...);
+	};
+}
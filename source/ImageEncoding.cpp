@@ -0,0 +1,449 @@
+#include "ImageEncoding.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <string>
+
+namespace dae
+{
+	namespace
+	{
+		void WriteBigEndian(std::vector<uint8_t>& out, uint32_t value)
+		{
+			out.push_back(static_cast<uint8_t>(value >> 24));
+			out.push_back(static_cast<uint8_t>(value >> 16));
+			out.push_back(static_cast<uint8_t>(value >> 8));
+			out.push_back(static_cast<uint8_t>(value));
+		}
+
+		constexpr std::array<uint32_t, 256> CrcTable{ []
+			{
+				std::array<uint32_t, 256> table{};
+				for (uint32_t index{}; index < 256; ++index)
+				{
+					uint32_t crc{ index };
+					for (int bit{}; bit < 8; ++bit)
+					{
+						crc = (crc & 1) ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+					}
+					table[index] = crc;
+				}
+				return table;
+			}() };
+
+		uint32_t Crc32(const uint8_t* pData, size_t size)
+		{
+			uint32_t crc{ 0xffffffffu };
+			for (size_t index{}; index < size; ++index)
+			{
+				crc = CrcTable[(crc ^ pData[index]) & 0xff] ^ (crc >> 8);
+			}
+			return crc ^ 0xffffffffu;
+		}
+
+		uint32_t Adler32(const uint8_t* pData, size_t size)
+		{
+			//Largest block before the sums can overflow 32 bit
+			constexpr size_t blockSize{ 5552 };
+
+			uint32_t a{ 1 };
+			uint32_t b{};
+			while (size > 0)
+			{
+				const size_t count{ std::min(size, blockSize) };
+				for (size_t index{}; index < count; ++index)
+				{
+					a += pData[index];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+				pData += count;
+				size -= count;
+			}
+			return (b << 16) | a;
+		}
+
+		//Deflate writes bits starting at the least significant bit of every byte
+		class BitWriter final
+		{
+		public:
+			explicit BitWriter(std::vector<uint8_t>& out) :
+				m_Out{ out }
+			{
+			}
+
+			void Write(uint32_t value, int bitCount)
+			{
+				m_Bits |= static_cast<uint64_t>(value) << m_BitCount;
+				m_BitCount += bitCount;
+				while (m_BitCount >= 8)
+				{
+					m_Out.push_back(static_cast<uint8_t>(m_Bits));
+					m_Bits >>= 8;
+					m_BitCount -= 8;
+				}
+			}
+
+			void Flush()
+			{
+				if (m_BitCount > 0)
+					m_Out.push_back(static_cast<uint8_t>(m_Bits));
+				m_Bits = 0;
+				m_BitCount = 0;
+			}
+
+		private:
+			std::vector<uint8_t>& m_Out;
+			uint64_t m_Bits{};
+			int m_BitCount{};
+		};
+
+		struct HuffmanCode
+		{
+			uint16_t bits{};
+			uint8_t length{};
+		};
+
+		constexpr uint32_t ReverseBits(uint32_t value, int bitCount)
+		{
+			uint32_t reversed{};
+			for (int bit{}; bit < bitCount; ++bit)
+			{
+				reversed = (reversed << 1) | ((value >> bit) & 1);
+			}
+			return reversed;
+		}
+
+		//Fixed literal/length code of RFC 1951 3.2.6, stored bit reversed so it can go straight into the BitWriter
+		constexpr std::array<HuffmanCode, 288> FixedLiteralCodes{ []
+			{
+				std::array<HuffmanCode, 288> codes{};
+				for (uint32_t symbol{}; symbol < 288; ++symbol)
+				{
+					uint32_t code{};
+					int length{};
+					if (symbol < 144)
+					{
+						code = 0x30 + symbol;
+						length = 8;
+					}
+					else if (symbol < 256)
+					{
+						code = 0x190 + symbol - 144;
+						length = 9;
+					}
+					else if (symbol < 280)
+					{
+						code = symbol - 256;
+						length = 7;
+					}
+					else
+					{
+						code = 0xc0 + symbol - 280;
+						length = 8;
+					}
+					codes[symbol] = { static_cast<uint16_t>(ReverseBits(code, length)), static_cast<uint8_t>(length) };
+				}
+				return codes;
+			}() };
+
+		void WriteLiteral(BitWriter& writer, uint32_t symbol)
+		{
+			const HuffmanCode code{ FixedLiteralCodes[symbol] };
+			writer.Write(code.bits, code.length);
+		}
+
+		//Length 3..258 -> symbol 257..285 plus extra bits, every power of two range is split in 4 symbols
+		void WriteLength(BitWriter& writer, int length)
+		{
+			const uint32_t offset{ static_cast<uint32_t>(length - 3) };
+			if (length == 258)
+			{
+				WriteLiteral(writer, 285);
+			}
+			else if (offset < 8)
+			{
+				WriteLiteral(writer, 257 + offset);
+			}
+			else
+			{
+				const int highBit{ static_cast<int>(std::bit_width(offset)) - 1 };
+				const int extraBitCount{ highBit - 2 };
+				WriteLiteral(writer, 257 + 4 * (highBit - 1) + ((offset >> extraBitCount) & 3));
+				writer.Write(offset & ((1u << extraBitCount) - 1), extraBitCount);
+			}
+		}
+
+		//Distance 1..32768 -> 5 bit symbol 0..29 plus extra bits, every power of two range is split in 2 symbols
+		void WriteDistance(BitWriter& writer, int distance)
+		{
+			const uint32_t offset{ static_cast<uint32_t>(distance - 1) };
+			if (offset < 4)
+			{
+				writer.Write(ReverseBits(offset, 5), 5);
+			}
+			else
+			{
+				const int highBit{ static_cast<int>(std::bit_width(offset)) - 1 };
+				const int extraBitCount{ highBit - 1 };
+				writer.Write(ReverseBits(2 * highBit + ((offset >> extraBitCount) & 1), 5), 5);
+				writer.Write(offset & ((1u << extraBitCount) - 1), extraBitCount);
+			}
+		}
+
+		void Deflate(const std::vector<uint8_t>& data, std::vector<uint8_t>& out)
+		{
+			constexpr int hashBits{ 15 };
+			constexpr int windowSize{ 32768 };
+			constexpr int minMatch{ 3 };
+			constexpr int maxMatch{ 258 };
+
+			const uint8_t* pData{ data.data() };
+			const int size{ static_cast<int>(data.size()) };
+
+			//Last position every hash of 3 bytes was seen at
+			std::vector<int> lastPositions(size_t{ 1 } << hashBits, -windowSize - 1);
+			auto hash = [pData](int position)
+			{
+				const uint32_t bytes{ pData[position] | static_cast<uint32_t>(pData[position + 1]) << 8 | static_cast<uint32_t>(pData[position + 2]) << 16 };
+				return (bytes * 2654435761u) >> (32 - hashBits);
+			};
+
+			BitWriter writer{ out };
+			//Final block, fixed Huffman codes
+			writer.Write(1, 1);
+			writer.Write(1, 2);
+
+			int position{};
+			while (position < size)
+			{
+				int matchLength{};
+				int matchDistance{};
+				if (position + minMatch <= size)
+				{
+					const uint32_t positionHash{ hash(position) };
+					const int candidate{ lastPositions[positionHash] };
+					lastPositions[positionHash] = position;
+
+					if (position - candidate <= windowSize)
+					{
+						const int maxLength{ std::min(maxMatch, size - position) };
+						while (matchLength < maxLength && pData[candidate + matchLength] == pData[position + matchLength])
+						{
+							++matchLength;
+						}
+						matchDistance = position - candidate;
+					}
+				}
+
+				if (matchLength >= minMatch)
+				{
+					WriteLength(writer, matchLength);
+					WriteDistance(writer, matchDistance);
+
+					//Keep the table up to date inside the match as well, long runs of background compress a lot better
+					const int end{ std::min(position + matchLength, size - minMatch + 1) };
+					for (int skipped{ position + 1 }; skipped < end; ++skipped)
+					{
+						lastPositions[hash(skipped)] = skipped;
+					}
+					position += matchLength;
+				}
+				else
+				{
+					WriteLiteral(writer, pData[position]);
+					++position;
+				}
+			}
+
+			//End of block
+			WriteLiteral(writer, 256);
+			writer.Flush();
+		}
+
+		void WritePngChunk(std::vector<uint8_t>& out, const char* pType, const std::vector<uint8_t>& data)
+		{
+			WriteBigEndian(out, static_cast<uint32_t>(data.size()));
+			const size_t typeStart{ out.size() };
+			out.insert(out.end(), pType, pType + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			WriteBigEndian(out, Crc32(out.data() + typeStart, out.size() - typeStart));
+		}
+	}
+
+	void Utils::EncodeQOI(const uint32_t* pPixels, int width, int height, const ColorFormat& format, std::vector<uint8_t>& out)
+	{
+		constexpr uint8_t opIndex{ 0x00 };
+		constexpr uint8_t opDiff{ 0x40 };
+		constexpr uint8_t opLuma{ 0x80 };
+		constexpr uint8_t opRun{ 0xc0 };
+		constexpr uint8_t opRGB{ 0xfe };
+		constexpr int maxRun{ 62 };
+
+		out.clear();
+		//Worst case every pixel is a 4 byte RGB op
+		out.reserve(14 + static_cast<size_t>(width) * height * 4 + 8);
+
+		out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+		WriteBigEndian(out, static_cast<uint32_t>(width));
+		WriteBigEndian(out, static_cast<uint32_t>(height));
+		//3 channels, sRGB
+		out.push_back(3);
+		out.push_back(0);
+
+		//Pixels as RGBA with alpha always 255, the seen pixels start out as transparent black like the decoder's
+		uint32_t seen[64]{};
+		uint32_t previous{ 0xff };
+		int run{};
+
+		const size_t pixelCount{ static_cast<size_t>(width) * height };
+		for (size_t index{}; index < pixelCount; ++index)
+		{
+			const uint32_t pixel{ pPixels[index] };
+			const uint8_t red{ static_cast<uint8_t>(pixel >> format.redShift) };
+			const uint8_t green{ static_cast<uint8_t>(pixel >> format.greenShift) };
+			const uint8_t blue{ static_cast<uint8_t>(pixel >> format.blueShift) };
+			const uint32_t current{ static_cast<uint32_t>(red) << 24 | static_cast<uint32_t>(green) << 16 | static_cast<uint32_t>(blue) << 8 | 0xff };
+
+			if (current == previous)
+			{
+				++run;
+				if (run == maxRun || index + 1 == pixelCount)
+				{
+					out.push_back(static_cast<uint8_t>(opRun | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+
+			if (run > 0)
+			{
+				out.push_back(static_cast<uint8_t>(opRun | (run - 1)));
+				run = 0;
+			}
+
+			const int hash{ (red * 3 + green * 5 + blue * 7 + 255 * 11) % 64 };
+			if (seen[hash] == current)
+			{
+				out.push_back(static_cast<uint8_t>(opIndex | hash));
+			}
+			else
+			{
+				seen[hash] = current;
+
+				//Differences wrap around like the bytes themselves
+				const int redDiff{ static_cast<int8_t>(red - (previous >> 24)) };
+				const int greenDiff{ static_cast<int8_t>(green - (previous >> 16)) };
+				const int blueDiff{ static_cast<int8_t>(blue - (previous >> 8)) };
+				const int redGreenDiff{ redDiff - greenDiff };
+				const int blueGreenDiff{ blueDiff - greenDiff };
+
+				if (redDiff >= -2 && redDiff <= 1 && greenDiff >= -2 && greenDiff <= 1 && blueDiff >= -2 && blueDiff <= 1)
+				{
+					out.push_back(static_cast<uint8_t>(opDiff | (redDiff + 2) << 4 | (greenDiff + 2) << 2 | (blueDiff + 2)));
+				}
+				else if (greenDiff >= -32 && greenDiff <= 31 && redGreenDiff >= -8 && redGreenDiff <= 7 && blueGreenDiff >= -8 && blueGreenDiff <= 7)
+				{
+					out.push_back(static_cast<uint8_t>(opLuma | (greenDiff + 32)));
+					out.push_back(static_cast<uint8_t>((redGreenDiff + 8) << 4 | (blueGreenDiff + 8)));
+				}
+				else
+				{
+					out.insert(out.end(), { opRGB, red, green, blue });
+				}
+			}
+			previous = current;
+		}
+
+		//End marker
+		out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+	}
+
+	void Utils::EncodePNG(const uint32_t* pPixels, int width, int height, const ColorFormat& format, std::vector<uint8_t>& out)
+	{
+		//Filter type byte + RGB per row, Up stores the difference with the row above (0 above the first row)
+		const size_t rowSize{ 1 + static_cast<size_t>(width) * 3 };
+		std::vector<uint8_t> filtered(rowSize * height);
+		for (int py{}; py < height; ++py)
+		{
+			uint8_t* pRow{ filtered.data() + py * rowSize };
+			*pRow++ = 2;
+
+			const uint32_t* pPixelRow{ pPixels + static_cast<size_t>(py) * width };
+			const uint32_t* pAboveRow{ py > 0 ? pPixelRow - width : nullptr };
+			for (int px{}; px < width; ++px)
+			{
+				const uint32_t pixel{ pPixelRow[px] };
+				const uint32_t above{ pAboveRow ? pAboveRow[px] : 0 };
+				*pRow++ = static_cast<uint8_t>((pixel >> format.redShift) - (above >> format.redShift));
+				*pRow++ = static_cast<uint8_t>((pixel >> format.greenShift) - (above >> format.greenShift));
+				*pRow++ = static_cast<uint8_t>((pixel >> format.blueShift) - (above >> format.blueShift));
+			}
+		}
+
+		out.clear();
+		out.insert(out.end(), { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' });
+
+		std::vector<uint8_t> header{};
+		WriteBigEndian(header, static_cast<uint32_t>(width));
+		WriteBigEndian(header, static_cast<uint32_t>(height));
+		//8 bit, truecolour, deflate, adaptive filtering, not interlaced
+		header.insert(header.end(), { 8, 2, 0, 0, 0 });
+		WritePngChunk(out, "IHDR", header);
+
+		//zlib stream: 32K window, fastest level flag
+		std::vector<uint8_t> compressed{ 0x78, 0x01 };
+		compressed.reserve(filtered.size() / 4);
+		Deflate(filtered, compressed);
+		WriteBigEndian(compressed, Adler32(filtered.data(), filtered.size()));
+		WritePngChunk(out, "IDAT", compressed);
+
+		WritePngChunk(out, "IEND", {});
+	}
+
+	void Utils::EncodeImage(ImageFormat imageFormat, const uint32_t* pPixels, int width, int height, const ColorFormat& format, std::vector<uint8_t>& out)
+	{
+		switch (imageFormat)
+		{
+		case ImageFormat::QOI:
+			EncodeQOI(pPixels, width, height, format, out);
+			break;
+		case ImageFormat::PNG:
+		default:
+			EncodePNG(pPixels, width, height, format, out);
+			break;
+		}
+	}
+
+	const char* Utils::GetImageExtension(ImageFormat imageFormat)
+	{
+		switch (imageFormat)
+		{
+		case ImageFormat::QOI:
+			return ".qoi";
+		case ImageFormat::PNG:
+		default:
+			return ".png";
+		}
+	}
+
+	bool Utils::ParseImageFormat(const char* pName, ImageFormat& imageFormat)
+	{
+		if (!pName)
+			return false;
+
+		std::string name{ pName };
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char character) { return static_cast<char>(std::tolower(character)); });
+
+		if (name == "png")
+			imageFormat = ImageFormat::PNG;
+		else if (name == "qoi")
+			imageFormat = ImageFormat::QOI;
+		else
+			return false;
+		return true;
+	}
+}
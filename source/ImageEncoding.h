@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	enum class ImageFormat
+	{
+		PNG,
+		QOI
+	};
+
+	namespace Utils
+	{
+		//Lossless encoders that need neither SDL_image nor zlib, the pixels are tightly packed rows of 32 bit pixels in the given ColorFormat
+		//Both store 8 bit RGB, the alpha channel of the render targets carries nothing
+
+		//Quite OK Image format (qoiformat.org), one pass over the pixels
+		void EncodeQOI(const uint32_t* pPixels, int width, int height, const ColorFormat& format, std::vector<uint8_t>& out);
+		//Every row uses the Up filter and the deflate stream is a single block with the fixed Huffman codes,
+		//matches come from one hash probe per position, about what zlib does at its fastest level
+		void EncodePNG(const uint32_t* pPixels, int width, int height, const ColorFormat& format, std::vector<uint8_t>& out);
+
+		void EncodeImage(ImageFormat imageFormat, const uint32_t* pPixels, int width, int height, const ColorFormat& format, std::vector<uint8_t>& out);
+		const char* GetImageExtension(ImageFormat imageFormat);
+		bool ParseImageFormat(const char* pName, ImageFormat& imageFormat);
+	}
+}
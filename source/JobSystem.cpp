@@ -0,0 +1,300 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace dae
+{
+	class JobSystem::Job final
+	{
+	public:
+		std::function<void()> function{};
+		//One for every unfinished dependency, plus one that Schedule releases once all of them are registered
+		std::atomic<uint32_t> pendingCount{ 1 };
+		std::atomic<bool> isFinished{ false };
+
+		std::mutex mutex{};
+		std::vector<JobHandle> continuations{};
+		//Keeps the job alive while it sits in a queue
+		JobHandle self{};
+	};
+
+	namespace
+	{
+		//Queue of the current thread, threads outside the system (or of another one) use the shared queue 0
+		thread_local const JobSystem* t_pJobSystem{};
+		thread_local uint32_t t_QueueIndex{};
+	}
+
+	JobSystem::JobSystem(uint32_t threadCount, bool isPinned) :
+		m_IsPinned{ isPinned }
+	{
+		const uint32_t hardwareThreadCount{ std::max(std::thread::hardware_concurrency(), 1u) };
+		if (threadCount == 0)
+			threadCount = hardwareThreadCount;
+		const uint32_t workerCount{ threadCount - 1 };
+
+		m_QueueCount = workerCount + 1;
+		m_pQueues = std::make_unique<TaskQueue[]>(m_QueueCount);
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t index{}; index < workerCount; ++index)
+		{
+			m_Workers.emplace_back(&JobSystem::WorkerLoop, this, index);
+			//Processor 0 is left to the thread that created the system
+			if (m_IsPinned)
+				PinWorker(m_Workers.back(), (index + 1) % hardwareThreadCount);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard lock{ m_SleepMutex };
+			m_IsStopping = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+
+		//Jobs nobody waited for still run, they may own resources
+		while (TryRunTask())
+		{
+		}
+	}
+
+	void JobSystem::ParallelFor(uint32_t jobCount, FunctionRef<void(uint32_t)> job)
+	{
+		if (jobCount == 0)
+			return;
+
+		//Not worth waking anyone up for a single job
+		if (jobCount == 1 || m_Workers.empty())
+		{
+			for (uint32_t index{}; index < jobCount; ++index)
+			{
+				job(index);
+			}
+			return;
+		}
+
+		ParallelForContext context{ job, jobCount };
+		RunRange(*this, &context, 0, jobCount);
+
+		while (context.remaining.load(std::memory_order_acquire) != 0)
+		{
+			if (!TryRunTask())
+				std::this_thread::yield();
+		}
+	}
+
+	JobSystem::JobHandle JobSystem::Schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies)
+	{
+		const JobHandle job{ std::make_shared<Job>() };
+		job->function = std::move(function);
+
+		for (const JobHandle& dependency : dependencies)
+		{
+			if (!dependency)
+				continue;
+
+			std::lock_guard lock{ dependency->mutex };
+			if (dependency->isFinished.load(std::memory_order_acquire))
+				continue;
+
+			job->pendingCount.fetch_add(1);
+			dependency->continuations.push_back(job);
+		}
+
+		if (job->pendingCount.fetch_sub(1) == 1)
+			Enqueue(job);
+		return job;
+	}
+
+	void JobSystem::Wait(const JobHandle& job)
+	{
+		while (job && !job->isFinished.load(std::memory_order_acquire))
+		{
+			if (!TryRunTask())
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::Wait(const std::vector<JobHandle>& jobs)
+	{
+		for (const JobHandle& job : jobs)
+		{
+			Wait(job);
+		}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t workerIndex)
+	{
+		t_pJobSystem = this;
+		t_QueueIndex = workerIndex + 1;
+
+		while (true)
+		{
+			if (TryRunTask())
+				continue;
+
+			std::unique_lock lock{ m_SleepMutex };
+			//Registered before the check, Push notifies whenever it sees a sleeping worker after queueing
+			m_SleepingWorkers.fetch_add(1);
+			m_WakeCondition.wait(lock, [this] { return m_IsStopping || m_QueuedTasks.load() != 0; });
+			m_SleepingWorkers.fetch_sub(1);
+			if (m_IsStopping)
+				return;
+		}
+	}
+
+	void JobSystem::Push(const Task& task)
+	{
+		TaskQueue& queue{ m_pQueues[t_pJobSystem == this ? t_QueueIndex : 0] };
+		bool isQueued{ false };
+		{
+			std::lock_guard lock{ queue.mutex };
+			if (queue.count < TaskQueue::Capacity)
+			{
+				queue.tasks[(queue.front + queue.count) % TaskQueue::Capacity] = task;
+				++queue.count;
+				m_QueuedTasks.fetch_add(1);
+				isQueued = true;
+			}
+		}
+
+		if (!isQueued)
+		{
+			task.pFunction(*this, task.pContext, task.begin, task.end);
+			return;
+		}
+
+		if (m_SleepingWorkers.load() != 0)
+		{
+			std::lock_guard lock{ m_SleepMutex };
+			m_WakeCondition.notify_one();
+		}
+	}
+
+	bool JobSystem::TryPop(uint32_t queueIndex, bool isOwner, Task& task)
+	{
+		TaskQueue& queue{ m_pQueues[queueIndex] };
+		std::lock_guard lock{ queue.mutex };
+		if (queue.count == 0)
+			return false;
+
+		//The owner takes the newest task, its data is still in cache, thieves take the oldest and usually largest one
+		if (isOwner)
+		{
+			task = queue.tasks[(queue.front + queue.count - 1) % TaskQueue::Capacity];
+		}
+		else
+		{
+			task = queue.tasks[queue.front];
+			queue.front = (queue.front + 1) % TaskQueue::Capacity;
+		}
+		--queue.count;
+		m_QueuedTasks.fetch_sub(1);
+		return true;
+	}
+
+	bool JobSystem::TryRunTask()
+	{
+		if (m_QueuedTasks.load() == 0)
+			return false;
+
+		const uint32_t ownIndex{ t_pJobSystem == this ? t_QueueIndex : 0 };
+		Task task{};
+		bool isFound{ TryPop(ownIndex, true, task) };
+		for (uint32_t offset{ 1 }; !isFound && offset < m_QueueCount; ++offset)
+		{
+			isFound = TryPop((ownIndex + offset) % m_QueueCount, false, task);
+		}
+
+		if (!isFound)
+			return false;
+
+		task.pFunction(*this, task.pContext, task.begin, task.end);
+		return true;
+	}
+
+	void JobSystem::Enqueue(const JobHandle& job)
+	{
+		job->self = job;
+		Push({ &JobSystem::RunJob, job.get() });
+	}
+
+	void JobSystem::PinWorker(std::thread& worker, uint32_t processorIndex)
+	{
+#if defined(_WIN32)
+		//Processors are numbered group after group, hosts with more than 64 of them have several groups
+		WORD group{};
+		DWORD groupProcessor{ processorIndex };
+		const WORD groupCount{ GetActiveProcessorGroupCount() };
+		while (group + 1 < groupCount && groupProcessor >= GetActiveProcessorCount(group))
+		{
+			groupProcessor -= GetActiveProcessorCount(group);
+			++group;
+		}
+
+		GROUP_AFFINITY affinity{};
+		affinity.Group = group;
+		affinity.Mask = KAFFINITY{ 1 } << groupProcessor;
+		SetThreadGroupAffinity(worker.native_handle(), &affinity, nullptr);
+#elif defined(__linux__)
+		cpu_set_t processors{};
+		CPU_ZERO(&processors);
+		CPU_SET(processorIndex, &processors);
+		pthread_setaffinity_np(worker.native_handle(), sizeof(processors), &processors);
+#else
+		(void)worker;
+		(void)processorIndex;
+#endif
+	}
+
+	void JobSystem::RunRange(JobSystem& jobSystem, void* pContext, uint32_t begin, uint32_t end)
+	{
+		ParallelForContext& context{ *static_cast<ParallelForContext*>(pContext) };
+
+		//Hand the upper half to whoever is idle until a single index is left
+		while (end - begin > 1)
+		{
+			const uint32_t middle{ begin + (end - begin) / 2 };
+			jobSystem.Push({ &JobSystem::RunRange, pContext, middle, end });
+			end = middle;
+		}
+
+		context.job(begin);
+		context.remaining.fetch_sub(1, std::memory_order_release);
+	}
+
+	void JobSystem::RunJob(JobSystem& jobSystem, void* pContext, uint32_t, uint32_t)
+	{
+		const JobHandle job{ std::move(static_cast<Job*>(pContext)->self) };
+		job->function();
+
+		std::vector<JobHandle> continuations{};
+		{
+			std::lock_guard lock{ job->mutex };
+			job->isFinished.store(true, std::memory_order_release);
+			continuations.swap(job->continuations);
+		}
+
+		for (const JobHandle& continuation : continuations)
+		{
+			if (continuation->pendingCount.fetch_sub(1) == 1)
+				jobSystem.Enqueue(continuation);
+		}
+	}
+}
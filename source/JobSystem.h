@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FunctionRef.h"
+
+namespace dae
+{
+	//Work-stealing scheduler shared by every stage that wants parallelism, so they never oversubscribe the cores
+	//Every worker owns a queue it pushes to and pops from at the back, idle workers steal from the front of the others
+	//Threads outside the system share one extra queue, and every thread that waits for work helps executing it
+	class JobSystem final
+	{
+	public:
+		class Job;
+		//Keeps a scheduled job alive, it can be waited for or passed as a dependency of later jobs
+		using JobHandle = std::shared_ptr<Job>;
+
+		//threadCount includes the thread that waits, it runs one worker less, 0 uses every hardware thread
+		//Pinned workers each stay on one logical processor, the caller is left alone
+		explicit JobSystem(uint32_t threadCount = 0, bool isPinned = false);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) noexcept = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem& operator=(JobSystem&&) noexcept = delete;
+
+		//Runs job(index) for every index in [0, jobCount) and returns once all of them finished
+		//The range is split in halves on demand, so idle workers steal large parts instead of single indices
+		//Nothing is allocated, it runs every frame
+		void ParallelFor(uint32_t jobCount, FunctionRef<void(uint32_t)> job);
+
+		//Starts function once every dependency finished
+		JobHandle Schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies = {});
+		//Executes other jobs until this one finished
+		void Wait(const JobHandle& job);
+		void Wait(const std::vector<JobHandle>& jobs);
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+		bool IsPinned() const { return m_IsPinned; }
+
+	private:
+		//Part of a range, or a whole scheduled job when pFunction is RunJob
+		struct Task
+		{
+			void (*pFunction)(JobSystem& jobSystem, void* pContext, uint32_t begin, uint32_t end){};
+			void* pContext{};
+			uint32_t begin{};
+			uint32_t end{};
+		};
+
+		//Fixed capacity ring, pushing into a full queue runs the task right away instead
+		struct TaskQueue
+		{
+			static constexpr uint32_t Capacity{ 1024 };
+
+			std::mutex mutex{};
+			Task tasks[Capacity]{};
+			uint32_t front{};
+			uint32_t count{};
+		};
+
+		struct ParallelForContext
+		{
+			FunctionRef<void(uint32_t)> job;
+			std::atomic<uint32_t> remaining{};
+		};
+
+		//Index 0 is the shared queue of threads outside the system, worker i owns queue i + 1
+		std::unique_ptr<TaskQueue[]> m_pQueues{};
+		uint32_t m_QueueCount{};
+		std::vector<std::thread> m_Workers{};
+		const bool m_IsPinned;
+
+		//Sleeping workers are only woken up when there is something to take
+		std::mutex m_SleepMutex{};
+		std::condition_variable m_WakeCondition{};
+		std::atomic<uint32_t> m_QueuedTasks{};
+		std::atomic<uint32_t> m_SleepingWorkers{};
+		bool m_IsStopping{ false };
+
+		void WorkerLoop(uint32_t workerIndex);
+		void Push(const Task& task);
+		bool TryPop(uint32_t queueIndex, bool isOwner, Task& task);
+		//Own queue first, then the others starting after it
+		bool TryRunTask();
+		void Enqueue(const JobHandle& job);
+		void PinWorker(std::thread& worker, uint32_t processorIndex);
+
+		static void RunRange(JobSystem& jobSystem, void* pContext, uint32_t begin, uint32_t end);
+		static void RunJob(JobSystem& jobSystem, void* pContext, uint32_t begin, uint32_t end);
+	};
+}
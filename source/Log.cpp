@@ -0,0 +1,21 @@
+#include "Log.h"
+
+#include <iostream>
+
+namespace dae
+{
+	namespace
+	{
+		std::ostream* g_pLogStream{ &std::cout };
+	}
+
+	void Utils::SetLogStream(std::ostream& stream)
+	{
+		g_pLogStream = &stream;
+	}
+
+	std::ostream& Utils::GetLogStream()
+	{
+		return *g_pLogStream;
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <ostream>
+
+namespace dae
+{
+	namespace Utils
+	{
+		//Stream every diagnostic goes to, std::cout unless main picks another one
+		//stdout carries the frames while piping raw video (FrameSequenceFormat::RawRGB), main then logs to std::cerr
+		//Set it before starting the threads that log
+		void SetLogStream(std::ostream& stream);
+		std::ostream& GetLogStream();
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <type_traits>
 
 namespace dae
 {
@@ -21,12 +22,12 @@ namespace dae
 	constexpr auto TO_RADIANS(PI / 180.0f);
 
 	/* --- HELPER FUNCTIONS --- */
-	inline float Square(float a)
+	constexpr float Square(float a)
 	{
 		return a * a;
 	}
 
-	inline float Lerpf(float a, float b, float factor)
+	constexpr float Lerpf(float a, float b, float factor)
 	{
 		return ((1 - factor) * a) + (factor * b);
 	}
@@ -36,24 +37,58 @@ namespace dae
 		return abs(a - b) < epsilon;
 	}
 
-	inline int Clamp(const int v, int min, int max)
+	constexpr int Clamp(const int v, int min, int max)
 	{
 		if (v < min) return min;
 		if (v > max) return max;
 		return v;
 	}
 
-	inline float Clamp(const float v, float min, float max)
+	constexpr float Clamp(const float v, float min, float max)
 	{
 		if (v < min) return min;
 		if (v > max) return max;
 		return v;
 	}
 
-	inline float Saturate(const float v)
+	constexpr float Saturate(const float v)
 	{
 		if (v < 0.f) return 0.f;
 		if (v > 1.f) return 1.f;
 		return v;
 	}
+
+	//std::sin and std::cos are not constexpr yet, constant evaluation uses a Taylor series in double instead
+	constexpr double SinCosSeries(double angle, bool isCosine)
+	{
+		//Reduce to [-PI, PI] where the series converges quickly
+		constexpr double pi{ 3.14159265358979323846 };
+		while (angle > pi)
+			angle -= 2.0 * pi;
+		while (angle < -pi)
+			angle += 2.0 * pi;
+
+		double term{ isCosine ? 1.0 : angle };
+		double sum{ term };
+		for (int n{ isCosine ? 1 : 2 }; n < 40; n += 2)
+		{
+			term *= -angle * angle / (n * (n + 1.0));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr float Sin(float angle)
+	{
+		if (std::is_constant_evaluated())
+			return static_cast<float>(SinCosSeries(angle, false));
+		return std::sin(angle);
+	}
+
+	constexpr float Cos(float angle)
+	{
+		if (std::is_constant_evaluated())
+			return static_cast<float>(SinCosSeries(angle, true));
+		return std::cos(angle);
+	}
 }
\ No newline at end of file
@@ -1,92 +1,230 @@
 #include "Matrix.h"
 
+#include <algorithm>
 #include <cassert>
+#include <type_traits>
 
 #include "MathHelpers.h"
+#include "SIMD.h"
 #include <cmath>
 
 namespace dae {
-	Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
-		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+	namespace
 	{
-	}
+		simd::Matrix4 BroadcastMatrix(const Matrix& matrix)
+		{
+			float elements[4][4];
+			matrix.GetElements(elements);
+			return simd::Broadcast(elements);
+		}
 
-	Matrix::Matrix(const Vector4& xAxis, const Vector4& yAxis, const Vector4& zAxis, const Vector4& t)
-	{
-		data[0] = xAxis;
-		data[1] = yAxis;
-		data[2] = zAxis;
-		data[3] = t;
-	}
+		//AoS spans go through the SoA math one block of simd::Width elements at a time, the components are transposed into lanes,
+		//transformBlock(x, y, z, w) transforms the lanes in place and they are transposed back
+		//A whole block is read before any of it is written, so out may be the input span
+		template<typename Element, typename Function>
+		void TransformBlocks(std::span<const Element> in, std::span<Element> out, Function transformBlock)
+		{
+			constexpr bool hasW{ std::is_same_v<Element, Vector4> };
+			alignas(64) float x[simd::Width]{};
+			alignas(64) float y[simd::Width]{};
+			alignas(64) float z[simd::Width]{};
+			alignas(64) float w[simd::Width]{};
 
-	Matrix::Matrix(const Matrix& m)
-	{
-		data[0] = m[0];
-		data[1] = m[1];
-		data[2] = m[2];
-		data[3] = m[3];
+			for (size_t first{}; first < in.size(); first += simd::Width)
+			{
+				//Lanes after the tail keep the values of the previous block, their results are dropped
+				const size_t count{ std::min(static_cast<size_t>(simd::Width), in.size() - first) };
+				for (size_t lane{}; lane < count; ++lane)
+				{
+					const Element& element{ in[first + lane] };
+					x[lane] = element.x;
+					y[lane] = element.y;
+					z[lane] = element.z;
+				}
+
+				transformBlock(x, y, z, w);
+
+				for (size_t lane{}; lane < count; ++lane)
+				{
+					Element& element{ out[first + lane] };
+					element.x = x[lane];
+					element.y = y[lane];
+					element.z = z[lane];
+					if constexpr (hasW)
+						element.w = w[lane];
+				}
+			}
+		}
 	}
 
-	Vector3 Matrix::TransformVector(const Vector3& v) const
+	void Matrix::TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const
 	{
-		return TransformVector(v.x, v.y, v.z);
-	}
+		using namespace simd;
+		assert(out.size() >= points.size());
 
-	Vector3 Matrix::TransformVector(float x, float y, float z) const
-	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z,
-			data[0].y * x + data[1].y * y + data[2].y * z,
-			data[0].z * x + data[1].z * y + data[2].z * z
-		};
+		const Matrix4 matrix{ BroadcastMatrix(*this) };
+		TransformBlocks(points, out, [&matrix](float* pX, float* pY, float* pZ, float*)
+			{
+				const Float x{ Load(pX) };
+				const Float y{ Load(pY) };
+				const Float z{ Load(pZ) };
+				Store(pX, simd::TransformPoint(matrix, x, y, z, 0));
+				Store(pY, simd::TransformPoint(matrix, x, y, z, 1));
+				Store(pZ, simd::TransformPoint(matrix, x, y, z, 2));
+			});
 	}
 
-	Vector3 Matrix::TransformPoint(const Vector3& p) const
+	void Matrix::TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out, bool normalize) const
 	{
-		return TransformPoint(p.x, p.y, p.z);
-	}
+		using namespace simd;
+		assert(out.size() >= vectors.size());
 
-	Vector3 Matrix::TransformPoint(float x, float y, float z) const
-	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-		};
-	}
+		const Matrix4 matrix{ BroadcastMatrix(*this) };
+		TransformBlocks(vectors, out, [&matrix, normalize](float* pX, float* pY, float* pZ, float*)
+			{
+				const Float x{ Load(pX) };
+				const Float y{ Load(pY) };
+				const Float z{ Load(pZ) };
+				Float tx{ simd::TransformVector(matrix, x, y, z, 0) };
+				Float ty{ simd::TransformVector(matrix, x, y, z, 1) };
+				Float tz{ simd::TransformVector(matrix, x, y, z, 2) };
+				if (normalize)
+					simd::Normalize(tx, ty, tz);
+
+				Store(pX, tx);
+				Store(pY, ty);
+				Store(pZ, tz);
+			});
+	}
+
+	void Matrix::TransformPoints(std::span<const Vector4> points, std::span<Vector4> out, bool perspectiveDivide) const
+	{
+		using namespace simd;
+		assert(out.size() >= points.size());
+
+		//Like the scalar TransformPoint the translation row is added as is, the input w is not read
+		const Matrix4 matrix{ BroadcastMatrix(*this) };
+		const Float one{ Set1(1.f) };
+		TransformBlocks(points, out, [&matrix, one, perspectiveDivide](float* pX, float* pY, float* pZ, float* pW)
+			{
+				const Float x{ Load(pX) };
+				const Float y{ Load(pY) };
+				const Float z{ Load(pZ) };
+				Float tx{ simd::TransformPoint(matrix, x, y, z, 0) };
+				Float ty{ simd::TransformPoint(matrix, x, y, z, 1) };
+				Float tz{ simd::TransformPoint(matrix, x, y, z, 2) };
+				const Float tw{ simd::TransformPoint(matrix, x, y, z, 3) };
+				if (perspectiveDivide)
+				{
+					const Float invW{ Div(one, tw) };
+					tx = Mul(tx, invW);
+					ty = Mul(ty, invW);
+					tz = Mul(tz, invW);
+				}
+
+				Store(pX, tx);
+				Store(pY, ty);
+				Store(pZ, tz);
+				Store(pW, tw);
+			});
+	}
+
+	void Matrix::TransformPoints(std::span<const float> x, std::span<const float> y, std::span<const float> z,
+		std::span<float> outX, std::span<float> outY, std::span<float> outZ, std::span<float> outW, bool perspectiveDivide) const
+	{
+		using namespace simd;
+
+		const size_t count{ x.size() };
+		assert(y.size() == count && z.size() == count);
+		assert(outX.size() >= count && outY.size() >= count && outZ.size() >= count && (outW.empty() || outW.size() >= count));
+
+		const Matrix4 matrix{ BroadcastMatrix(*this) };
+		const Float one{ Set1(1.f) };
+
+		size_t index{};
+		for (; index + Width <= count; index += Width)
+		{
+			const Float px{ Load(&x[index]) };
+			const Float py{ Load(&y[index]) };
+			const Float pz{ Load(&z[index]) };
+
+			Float tx{ simd::TransformPoint(matrix, px, py, pz, 0) };
+			Float ty{ simd::TransformPoint(matrix, px, py, pz, 1) };
+			Float tz{ simd::TransformPoint(matrix, px, py, pz, 2) };
+			const Float tw{ simd::TransformPoint(matrix, px, py, pz, 3) };
+			if (perspectiveDivide)
+			{
+				const Float invW{ Div(one, tw) };
+				tx = Mul(tx, invW);
+				ty = Mul(ty, invW);
+				tz = Mul(tz, invW);
+			}
 
-	Vector4 Matrix::TransformPoint(const Vector4& p) const
-	{
-		return TransformPoint(p.x, p.y, p.z, p.w);
-	}
+			Store(&outX[index], tx);
+			Store(&outY[index], ty);
+			Store(&outZ[index], tz);
+			if (!outW.empty())
+				Store(&outW[index], tw);
+		}
 
-	Vector4 Matrix::TransformPoint(float x, float y, float z, float w) const
-	{
-		return Vector4{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-			data[0].w * x + data[1].w * y + data[2].w * z + data[3].w
-		};
+		for (; index < count; ++index)
+		{
+			Vector4 point{ TransformPoint(x[index], y[index], z[index], 1.f) };
+			if (perspectiveDivide)
+			{
+				const float invW{ 1.f / point.w };
+				point.x *= invW;
+				point.y *= invW;
+				point.z *= invW;
+			}
+
+			outX[index] = point.x;
+			outY[index] = point.y;
+			outZ[index] = point.z;
+			if (!outW.empty())
+				outW[index] = point.w;
+		}
 	}
 
-	const Matrix& Matrix::Transpose()
+	void Matrix::TransformVectors(std::span<const float> x, std::span<const float> y, std::span<const float> z,
+		std::span<float> outX, std::span<float> outY, std::span<float> outZ, bool normalize) const
 	{
-		Matrix result{};
-		for (int r{ 0 }; r < 4; ++r)
+		using namespace simd;
+
+		const size_t count{ x.size() };
+		assert(y.size() == count && z.size() == count);
+		assert(outX.size() >= count && outY.size() >= count && outZ.size() >= count);
+
+		const Matrix4 matrix{ BroadcastMatrix(*this) };
+
+		size_t index{};
+		for (; index + Width <= count; index += Width)
 		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				result[r][c] = data[c][r];
-			}
+			const Float vx{ Load(&x[index]) };
+			const Float vy{ Load(&y[index]) };
+			const Float vz{ Load(&z[index]) };
+
+			Float tx{ simd::TransformVector(matrix, vx, vy, vz, 0) };
+			Float ty{ simd::TransformVector(matrix, vx, vy, vz, 1) };
+			Float tz{ simd::TransformVector(matrix, vx, vy, vz, 2) };
+			if (normalize)
+				simd::Normalize(tx, ty, tz);
+
+			Store(&outX[index], tx);
+			Store(&outY[index], ty);
+			Store(&outZ[index], tz);
 		}
 
-		data[0] = result[0];
-		data[1] = result[1];
-		data[2] = result[2];
-		data[3] = result[3];
+		for (; index < count; ++index)
+		{
+			Vector3 vector{ TransformVector(x[index], y[index], z[index]) };
+			if (normalize)
+				vector.Normalize();
 
-		return *this;
+			outX[index] = vector.x;
+			outY[index] = vector.y;
+			outZ[index] = vector.z;
+		}
 	}
 
 	const Matrix& Matrix::Inverse()
@@ -126,14 +264,6 @@ namespace dae {
 		return *this;
 	}
 
-	Matrix Matrix::Transpose(const Matrix& m)
-	{
-		Matrix out{ m };
-		out.Transpose();
-
-		return out;
-	}
-
 	Matrix Matrix::Inverse(const Matrix& m)
 	{
 		Matrix out{ m };
@@ -153,21 +283,6 @@ namespace dae {
 		return {};
 	}
 
-	Matrix Matrix::CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf)
-	{
-		//TODO W2
-		//
-		float a{ zf / (zf - zn) };
-		float b{ -(zf * zn) / (zf - zn) };
-
-		return {
-			{1 / (aspect * fov), 0,0,0},
-			{0,1 / fov,0,0},
-			{0,0,a,1},
-			{0,0,b,0}
-		};
-	}
-
 	Vector3 Matrix::GetAxisX() const
 	{
 		return data[0];
@@ -188,109 +303,15 @@ namespace dae {
 		return data[3];
 	}
 
-	Matrix Matrix::CreateTranslation(float x, float y, float z)
+	void Matrix::GetElements(float (&elements)[4][4]) const
 	{
-		return CreateTranslation({ x, y, z });
-	}
-
-	Matrix Matrix::CreateTranslation(const Vector3& t)
-	{
-		return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
-	}
-
-	Matrix Matrix::CreateRotationX(float pitch)
-	{
-		return {
-			{1, 0, 0, 0},
-			{0, cos(pitch), -sin(pitch), 0},
-			{0, sin(pitch), cos(pitch), 0},
-			{0, 0, 0, 1}
-		};
-	}
-
-	Matrix Matrix::CreateRotationY(float yaw)
-	{
-		return {
-			{cos(yaw), 0, -sin(yaw), 0},
-			{0, 1, 0, 0},
-			{sin(yaw), 0, cos(yaw), 0},
-			{0, 0, 0, 1}
-		};
-	}
-
-	Matrix Matrix::CreateRotationZ(float roll)
-	{
-		return {
-			{cos(roll), sin(roll), 0, 0},
-			{-sin(roll), cos(roll), 0, 0},
-			{0, 0, 1, 0},
-			{0, 0, 0, 1}
-		};
-	}
-
-	Matrix Matrix::CreateRotation(float pitch, float yaw, float roll)
-	{
-		return CreateRotation({ pitch, yaw, roll });
-	}
-
-	Matrix Matrix::CreateRotation(const Vector3& r)
-	{
-		return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
-	}
-
-	Matrix Matrix::CreateScale(float sx, float sy, float sz)
-	{
-		return { {sx, 0, 0}, {0, sy, 0}, {0, 0, sz}, Vector3::Zero };
-	}
-
-	Matrix Matrix::CreateScale(const Vector3& s)
-	{
-		return CreateScale(s[0], s[1], s[2]);
-	}
-
-#pragma region Operator Overloads
-	Vector4& Matrix::operator[](int index)
-	{
-		assert(index <= 3 && index >= 0);
-		return data[index];
-	}
-
-	Vector4 Matrix::operator[](int index) const
-	{
-		assert(index <= 3 && index >= 0);
-		return data[index];
-	}
-
-	Matrix Matrix::operator*(const Matrix& m) const
-	{
-		Matrix result{};
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
+		for (int row{}; row < 4; ++row)
 		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
-			}
+			elements[row][0] = data[row].x;
+			elements[row][1] = data[row].y;
+			elements[row][2] = data[row].z;
+			elements[row][3] = data[row].w;
 		}
-
-		return result;
 	}
 
-	const Matrix& Matrix::operator*=(const Matrix& m)
-	{
-		Matrix copy{ *this };
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
-		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				data[r][c] = Vector4::Dot(copy[r], m_transposed[c]);
-			}
-		}
-
-		return *this;
-	}
-#pragma endregion
 }
\ No newline at end of file
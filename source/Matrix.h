@@ -1,60 +1,84 @@
 #pragma once
+#include <cassert>
+#include <span>
+#include <type_traits>
+#include <xmmintrin.h>
+
 #include "Vector3.h"
 #include "Vector4.h"
+#include "MathHelpers.h"
 
 namespace dae {
 	struct Matrix
 	{
-		Matrix() = default;
-		Matrix(
+		constexpr Matrix() = default;
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
 			const Vector3& t);
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
 			const Vector4& t);
 
-		Matrix(const Matrix& m);
+		constexpr Matrix(const Matrix& m);
+
+		constexpr Vector3 TransformVector(const Vector3& v) const;
+		constexpr Vector3 TransformVector(float x, float y, float z) const;
+		constexpr Vector3 TransformPoint(const Vector3& p) const;
+		constexpr Vector3 TransformPoint(float x, float y, float z) const;
+
+		constexpr Vector4 TransformPoint(const Vector4& p) const;
+		constexpr Vector4 TransformPoint(float x, float y, float z, float w) const;
 
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
+		//Batch versions, the matrix is broadcast once and the span goes through the SoA math simd::Width elements at a time
+		//Every block is read before it is written, so out may be the input span
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector3> out) const;
+		void TransformVectors(std::span<const Vector3> vectors, std::span<Vector3> out, bool normalize = false) const;
+		//perspectiveDivide divides x, y and z by the resulting w, w itself is kept
+		void TransformPoints(std::span<const Vector4> points, std::span<Vector4> out, bool perspectiveDivide = false) const;
 
-		Vector4 TransformPoint(const Vector4& p) const;
-		Vector4 TransformPoint(float x, float y, float z, float w) const;
+		//Structure-of-arrays versions, simd::Width elements at a time and the tail one by one
+		//outW may be empty when the w component is not needed
+		void TransformPoints(std::span<const float> x, std::span<const float> y, std::span<const float> z,
+			std::span<float> outX, std::span<float> outY, std::span<float> outZ, std::span<float> outW, bool perspectiveDivide = false) const;
+		void TransformVectors(std::span<const float> x, std::span<const float> y, std::span<const float> z,
+			std::span<float> outX, std::span<float> outY, std::span<float> outZ, bool normalize = false) const;
 
-		const Matrix& Transpose();
+		constexpr const Matrix& Transpose();
 		const Matrix& Inverse();
 
 		Vector3 GetAxisX() const;
 		Vector3 GetAxisY() const;
 		Vector3 GetAxisZ() const;
 		Vector3 GetTranslation() const;
+		//Row-major copy for code that may not call the inline members, like the instruction set variant kernels
+		void GetElements(float (&elements)[4][4]) const;
 
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
+		static constexpr Matrix CreateTranslation(float x, float y, float z);
+		static constexpr Matrix CreateTranslation(const Vector3& t);
+		static constexpr Matrix CreateRotationX(float pitch);
+		static constexpr Matrix CreateRotationY(float yaw);
+		static constexpr Matrix CreateRotationZ(float roll);
+		static constexpr Matrix CreateRotation(float pitch, float yaw, float roll);
+		static constexpr Matrix CreateRotation(const Vector3& r);
+		static constexpr Matrix CreateScale(float sx, float sy, float sz);
+		static constexpr Matrix CreateScale(const Vector3& s);
+		static constexpr Matrix Transpose(const Matrix& m);
 		static Matrix Inverse(const Matrix& m);
 
 		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up);
-		static Matrix CreatePerspectiveFovLH(float fovy, float aspect, float zn, float zf);
+		static constexpr Matrix CreatePerspectiveFovLH(float fovy, float aspect, float zn, float zf);
+		//Same frustum with the depth range flipped, zn maps to 1 and zf to 0
+		static constexpr Matrix CreatePerspectiveFovLHReversed(float fovy, float aspect, float zn, float zf);
 
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+		constexpr Vector4& operator[](int index);
+		constexpr Vector4 operator[](int index) const;
+		constexpr Matrix operator*(const Matrix& m) const;
+		constexpr const Matrix& operator*=(const Matrix& m);
 
 	private:
 
@@ -72,4 +96,263 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
+
+	//Rows are aligned Vector4s, so the hot operations work on whole rows in SSE registers
+	constexpr Matrix::Matrix(const Vector4& xAxis, const Vector4& yAxis, const Vector4& zAxis, const Vector4& t)
+	{
+		data[0] = xAxis;
+		data[1] = yAxis;
+		data[2] = zAxis;
+		data[3] = t;
+	}
+
+	constexpr Matrix::Matrix(const Matrix& m)
+	{
+		data[0] = m.data[0];
+		data[1] = m.data[1];
+		data[2] = m.data[2];
+		data[3] = m.data[3];
+	}
+
+	constexpr Vector3 Matrix::TransformVector(const Vector3& v) const
+	{
+		return TransformVector(v.x, v.y, v.z);
+	}
+
+	constexpr Vector3 Matrix::TransformVector(float x, float y, float z) const
+	{
+		if (std::is_constant_evaluated())
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z,
+				data[0].y * x + data[1].y * y + data[2].y * z,
+				data[0].z * x + data[1].z * y + data[2].z * z
+			};
+		}
+
+		const __m128 result{ _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(x), _mm_load_ps(&data[0].x)),
+			_mm_mul_ps(_mm_set1_ps(y), _mm_load_ps(&data[1].x))),
+			_mm_mul_ps(_mm_set1_ps(z), _mm_load_ps(&data[2].x))) };
+
+		Vector4 out;
+		_mm_store_ps(&out.x, result);
+		return out.GetXYZ();
+	}
+
+	constexpr Vector3 Matrix::TransformPoint(const Vector3& p) const
+	{
+		return TransformPoint(p.x, p.y, p.z);
+	}
+
+	constexpr Vector3 Matrix::TransformPoint(float x, float y, float z) const
+	{
+		return TransformPoint(x, y, z, 1.f).GetXYZ();
+	}
+
+	constexpr Vector4 Matrix::TransformPoint(const Vector4& p) const
+	{
+		return TransformPoint(p.x, p.y, p.z, p.w);
+	}
+
+	constexpr Vector4 Matrix::TransformPoint(float x, float y, float z, float w) const
+	{
+		//The translation row is always added as is, w only exists for the overload
+		if (std::is_constant_evaluated())
+		{
+			return Vector4{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+				data[0].w * x + data[1].w * y + data[2].w * z + data[3].w
+			};
+		}
+
+		const __m128 result{ _mm_add_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(x), _mm_load_ps(&data[0].x)),
+			_mm_mul_ps(_mm_set1_ps(y), _mm_load_ps(&data[1].x))),
+			_mm_mul_ps(_mm_set1_ps(z), _mm_load_ps(&data[2].x))),
+			_mm_load_ps(&data[3].x)) };
+
+		Vector4 out;
+		_mm_store_ps(&out.x, result);
+		return out;
+	}
+
+	constexpr Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
+		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+	{
+	}
+
+	constexpr const Matrix& Matrix::Transpose()
+	{
+		Matrix result{};
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			for (int c{ 0 }; c < 4; ++c)
+			{
+				result[r][c] = data[c][r];
+			}
+		}
+
+		data[0] = result[0];
+		data[1] = result[1];
+		data[2] = result[2];
+		data[3] = result[3];
+
+		return *this;
+	}
+
+	constexpr Matrix Matrix::Transpose(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.Transpose();
+
+		return out;
+	}
+
+	constexpr Matrix Matrix::CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf)
+	{
+		//TODO W2
+		//
+		float a{ zf / (zf - zn) };
+		float b{ -(zf * zn) / (zf - zn) };
+
+		return {
+			{1 / (aspect * fov), 0,0,0},
+			{0,1 / fov,0,0},
+			{0,0,a,1},
+			{0,0,b,0}
+		};
+	}
+
+	constexpr Matrix Matrix::CreatePerspectiveFovLHReversed(float fov, float aspect, float zn, float zf)
+	{
+		//1 - the standard depth, so a and b of CreatePerspectiveFovLH become 1 - a and -b
+		float a{ -zn / (zf - zn) };
+		float b{ (zf * zn) / (zf - zn) };
+
+		return {
+			{1 / (aspect * fov), 0,0,0},
+			{0,1 / fov,0,0},
+			{0,0,a,1},
+			{0,0,b,0}
+		};
+	}
+
+	constexpr Matrix Matrix::CreateTranslation(float x, float y, float z)
+	{
+		return CreateTranslation({ x, y, z });
+	}
+
+	constexpr Matrix Matrix::CreateTranslation(const Vector3& t)
+	{
+		return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+	}
+
+	constexpr Matrix Matrix::CreateRotationX(float pitch)
+	{
+		return {
+			{1, 0, 0, 0},
+			{0, Cos(pitch), -Sin(pitch), 0},
+			{0, Sin(pitch), Cos(pitch), 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	constexpr Matrix Matrix::CreateRotationY(float yaw)
+	{
+		return {
+			{Cos(yaw), 0, -Sin(yaw), 0},
+			{0, 1, 0, 0},
+			{Sin(yaw), 0, Cos(yaw), 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	constexpr Matrix Matrix::CreateRotationZ(float roll)
+	{
+		return {
+			{Cos(roll), Sin(roll), 0, 0},
+			{-Sin(roll), Cos(roll), 0, 0},
+			{0, 0, 1, 0},
+			{0, 0, 0, 1}
+		};
+	}
+
+	constexpr Matrix Matrix::CreateRotation(float pitch, float yaw, float roll)
+	{
+		return CreateRotation({ pitch, yaw, roll });
+	}
+
+	constexpr Matrix Matrix::CreateRotation(const Vector3& r)
+	{
+		return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
+	}
+
+	constexpr Matrix Matrix::CreateScale(float sx, float sy, float sz)
+	{
+		return { {sx, 0, 0}, {0, sy, 0}, {0, 0, sz}, Vector3::Zero };
+	}
+
+	constexpr Matrix Matrix::CreateScale(const Vector3& s)
+	{
+		return CreateScale(s[0], s[1], s[2]);
+	}
+
+#pragma region Operator Overloads
+	constexpr Vector4& Matrix::operator[](int index)
+	{
+		assert(index <= 3 && index >= 0);
+		return data[index];
+	}
+
+	constexpr Vector4 Matrix::operator[](int index) const
+	{
+		assert(index <= 3 && index >= 0);
+		return data[index];
+	}
+
+	constexpr Matrix Matrix::operator*(const Matrix& m) const
+	{
+		Matrix result{ *this };
+		result *= m;
+		return result;
+	}
+
+	constexpr const Matrix& Matrix::operator*=(const Matrix& m)
+	{
+		//Row vectors: every result row is a linear combination of the rows of m
+		if (std::is_constant_evaluated())
+		{
+			const Matrix copy{ *this };
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					data[r][c] = copy.data[r].x * m.data[0][c] + copy.data[r].y * m.data[1][c] + copy.data[r].z * m.data[2][c] + copy.data[r].w * m.data[3][c];
+				}
+			}
+			return *this;
+		}
+
+		const __m128 row0{ _mm_load_ps(&m.data[0].x) };
+		const __m128 row1{ _mm_load_ps(&m.data[1].x) };
+		const __m128 row2{ _mm_load_ps(&m.data[2].x) };
+		const __m128 row3{ _mm_load_ps(&m.data[3].x) };
+
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			const Vector4 row{ data[r] };
+			const __m128 result{ _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(row.x), row0),
+				_mm_mul_ps(_mm_set1_ps(row.y), row1)),
+				_mm_mul_ps(_mm_set1_ps(row.z), row2)),
+				_mm_mul_ps(_mm_set1_ps(row.w), row3)) };
+			_mm_store_ps(&data[r].x, result);
+		}
+
+		return *this;
+	}
+#pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include "MeshSimplification.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+
+#include "Camera.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Symmetric 4x4 plane quadric (Garland & Heckbert), doubles to keep the sums stable
+		struct Quadric
+		{
+			double a2{}, ab{}, ac{}, ad{};
+			double b2{}, bc{}, bd{};
+			double c2{}, cd{};
+			double d2{};
+
+			static Quadric FromPlane(const Vector3& n, float d, double weight)
+			{
+				const double a{ n.x }, b{ n.y }, c{ n.z }, dd{ d };
+				return { a * a * weight, a * b * weight, a * c * weight, a * dd * weight,
+					b * b * weight, b * c * weight, b * dd * weight,
+					c * c * weight, c * dd * weight,
+					dd * dd * weight };
+			}
+
+			Quadric& operator+=(const Quadric& q)
+			{
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+				b2 += q.b2; bc += q.bc; bd += q.bd;
+				c2 += q.c2; cd += q.cd;
+				d2 += q.d2;
+				return *this;
+			}
+
+			//Sum of squared distances from p to all accumulated planes
+			double Evaluate(const Vector3& p) const
+			{
+				const double x{ p.x }, y{ p.y }, z{ p.z };
+				return a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+					+ b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+					+ c2 * z * z + 2.0 * cd * z
+					+ d2;
+			}
+		};
+
+		struct Collapse
+		{
+			double cost{};
+			uint32_t from{};
+			uint32_t to{};
+			uint32_t fromVersion{};
+			uint32_t toVersion{};
+
+			bool operator>(const Collapse& other) const { return cost > other.cost; }
+		};
+
+		//Only bitwise identical values are merged, so the hash works on the raw bytes
+		template<typename T>
+		struct BitwiseHash
+		{
+			size_t operator()(const T& value) const
+			{
+				const unsigned char* pBytes{ reinterpret_cast<const unsigned char*>(&value) };
+				uint64_t hash{ 14695981039346656037ull };
+				for (size_t i{}; i < sizeof(T); ++i)
+				{
+					hash = (hash ^ pBytes[i]) * 1099511628211ull;
+				}
+				return static_cast<size_t>(hash);
+			}
+		};
+
+		template<typename T>
+		struct BitwiseEqual
+		{
+			bool operator()(const T& a, const T& b) const
+			{
+				return std::memcmp(&a, &b, sizeof(T)) == 0;
+			}
+		};
+
+		void ComputeBounds(Mesh& mesh)
+		{
+			if (mesh.vertices.empty())
+				return;
+
+			Vector3 minimum{ mesh.vertices[0].position };
+			Vector3 maximum{ mesh.vertices[0].position };
+			for (const Vertex& vertex : mesh.vertices)
+			{
+				minimum = { std::min(minimum.x, vertex.position.x), std::min(minimum.y, vertex.position.y), std::min(minimum.z, vertex.position.z) };
+				maximum = { std::max(maximum.x, vertex.position.x), std::max(maximum.y, vertex.position.y), std::max(maximum.z, vertex.position.z) };
+			}
+
+			mesh.bounds = { minimum, maximum };
+			mesh.boundsCenter = (minimum + maximum) * 0.5f;
+			mesh.boundsRadius = 0.f;
+			for (const Vertex& vertex : mesh.vertices)
+			{
+				mesh.boundsRadius = std::max(mesh.boundsRadius, (vertex.position - mesh.boundsCenter).Magnitude());
+			}
+		}
+
+		//The OBJ parser emits one vertex per face corner, merge the ones that are exact copies
+		void WeldIdenticalVertices(Mesh& mesh)
+		{
+			std::unordered_map<Vertex, uint32_t, BitwiseHash<Vertex>, BitwiseEqual<Vertex>> lookup{};
+			lookup.reserve(mesh.vertices.size());
+
+			std::vector<Vertex> welded{};
+			welded.reserve(mesh.vertices.size());
+
+			std::vector<uint32_t> remap(mesh.vertices.size());
+			for (size_t index{}; index < mesh.vertices.size(); ++index)
+			{
+				const auto [it, isInserted] = lookup.try_emplace(mesh.vertices[index], static_cast<uint32_t>(welded.size()));
+				if (isInserted)
+					welded.push_back(mesh.vertices[index]);
+
+				remap[index] = it->second;
+			}
+
+			for (uint32_t& index : mesh.indices)
+			{
+				index = remap[index];
+			}
+			mesh.vertices = std::move(welded);
+		}
+	}
+
+	void Utils::GenerateLODs(Mesh& mesh, int levelCount, float reduction)
+	{
+		mesh.lods.clear();
+		ComputeBounds(mesh);
+
+		if (mesh.primitiveTopology != PrimitiveTopology::TriangleList || mesh.indices.size() < 3)
+		{
+			mesh.lods.push_back({ mesh.indices, static_cast<uint32_t>(mesh.vertices.size()), 0.f });
+			return;
+		}
+
+		WeldIdenticalVertices(mesh);
+
+		const uint32_t vertexCount{ static_cast<uint32_t>(mesh.vertices.size()) };
+		const uint32_t triangleCount{ static_cast<uint32_t>(mesh.indices.size() / 3) };
+
+		//Connectivity is based on position only, so vertices on uv/normal seams collapse together
+		std::unordered_map<Vector3, uint32_t, BitwiseHash<Vector3>, BitwiseEqual<Vector3>> positionLookup{};
+		std::vector<uint32_t> classOf(vertexCount);
+		std::vector<Vector3> classPositions{};
+		std::vector<std::vector<uint32_t>> classVertices{};
+		for (uint32_t index{}; index < vertexCount; ++index)
+		{
+			const auto [it, isInserted] = positionLookup.try_emplace(mesh.vertices[index].position, static_cast<uint32_t>(classPositions.size()));
+			if (isInserted)
+			{
+				classPositions.push_back(mesh.vertices[index].position);
+				classVertices.emplace_back();
+			}
+
+			classOf[index] = it->second;
+			classVertices[it->second].push_back(index);
+		}
+
+		const uint32_t classCount{ static_cast<uint32_t>(classPositions.size()) };
+		std::vector<uint32_t> triangleClasses(mesh.indices.size());
+		std::vector<bool> isTriangleAlive(triangleCount, true);
+		std::vector<std::vector<uint32_t>> classTriangles(classCount);
+		std::vector<Quadric> quadrics(classCount);
+		uint32_t liveTriangleCount{ triangleCount };
+
+		for (uint32_t triangle{}; triangle < triangleCount; ++triangle)
+		{
+			uint32_t* pClasses{ &triangleClasses[3 * size_t(triangle)] };
+			for (int corner{}; corner < 3; ++corner)
+			{
+				pClasses[corner] = classOf[mesh.indices[3 * size_t(triangle) + corner]];
+			}
+
+			if (pClasses[0] == pClasses[1] || pClasses[1] == pClasses[2] || pClasses[2] == pClasses[0])
+			{
+				isTriangleAlive[triangle] = false;
+				--liveTriangleCount;
+				continue;
+			}
+
+			for (int corner{}; corner < 3; ++corner)
+			{
+				classTriangles[pClasses[corner]].push_back(triangle);
+			}
+
+			const Vector3& p0{ classPositions[pClasses[0]] };
+			Vector3 normal{ Vector3::Cross(classPositions[pClasses[1]] - p0, classPositions[pClasses[2]] - p0) };
+			if (normal.SqrMagnitude() <= 0.f)
+				continue;
+
+			normal.Normalize();
+			const Quadric plane{ Quadric::FromPlane(normal, -Vector3::Dot(normal, p0), 1.0) };
+			for (int corner{}; corner < 3; ++corner)
+			{
+				quadrics[pClasses[corner]] += plane;
+			}
+		}
+
+		//Open borders get a perpendicular plane so the silhouette does not shrink away
+		const double boundaryWeight{ 10.0 };
+		std::unordered_map<uint64_t, uint32_t> edgeUseCount{};
+		auto edgeKey = [](uint32_t a, uint32_t b) { return (uint64_t(std::min(a, b)) << 32) | std::max(a, b); };
+		for (uint32_t triangle{}; triangle < triangleCount; ++triangle)
+		{
+			if (!isTriangleAlive[triangle])
+				continue;
+
+			const uint32_t* pClasses{ &triangleClasses[3 * size_t(triangle)] };
+			for (int corner{}; corner < 3; ++corner)
+			{
+				++edgeUseCount[edgeKey(pClasses[corner], pClasses[(corner + 1) % 3])];
+			}
+		}
+
+		for (uint32_t triangle{}; triangle < triangleCount; ++triangle)
+		{
+			if (!isTriangleAlive[triangle])
+				continue;
+
+			const uint32_t* pClasses{ &triangleClasses[3 * size_t(triangle)] };
+			const Vector3& p0{ classPositions[pClasses[0]] };
+			const Vector3 faceNormal{ Vector3::Cross(classPositions[pClasses[1]] - p0, classPositions[pClasses[2]] - p0) };
+			for (int corner{}; corner < 3; ++corner)
+			{
+				const uint32_t a{ pClasses[corner] };
+				const uint32_t b{ pClasses[(corner + 1) % 3] };
+				if (edgeUseCount[edgeKey(a, b)] != 1)
+					continue;
+
+				Vector3 borderNormal{ Vector3::Cross(classPositions[b] - classPositions[a], faceNormal) };
+				if (borderNormal.SqrMagnitude() <= 0.f)
+					continue;
+
+				borderNormal.Normalize();
+				const Quadric border{ Quadric::FromPlane(borderNormal, -Vector3::Dot(borderNormal, classPositions[a]), boundaryWeight) };
+				quadrics[a] += border;
+				quadrics[b] += border;
+			}
+		}
+
+		//Half-edge collapses only, so every level keeps using the original vertices
+		std::vector<bool> isClassAlive(classCount, true);
+		std::vector<uint32_t> versions(classCount);
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses{};
+
+		auto pushCollapse = [&](uint32_t from, uint32_t to)
+		{
+			Quadric combined{ quadrics[from] };
+			combined += quadrics[to];
+			collapses.push({ combined.Evaluate(classPositions[to]), from, to, versions[from], versions[to] });
+		};
+
+		auto pushTriangleEdges = [&](uint32_t triangle)
+		{
+			const uint32_t* pClasses{ &triangleClasses[3 * size_t(triangle)] };
+			for (int corner{}; corner < 3; ++corner)
+			{
+				pushCollapse(pClasses[corner], pClasses[(corner + 1) % 3]);
+				pushCollapse(pClasses[(corner + 1) % 3], pClasses[corner]);
+			}
+		};
+
+		for (uint32_t triangle{}; triangle < triangleCount; ++triangle)
+		{
+			if (isTriangleAlive[triangle])
+				pushTriangleEdges(triangle);
+		}
+
+		//Reject collapses that fold a remaining triangle over (or nearly onto) itself
+		auto isCollapseValid = [&](uint32_t from, uint32_t to)
+		{
+			for (uint32_t triangle : classTriangles[from])
+			{
+				if (!isTriangleAlive[triangle])
+					continue;
+
+				const uint32_t* pClasses{ &triangleClasses[3 * size_t(triangle)] };
+				if (pClasses[0] == to || pClasses[1] == to || pClasses[2] == to)
+					continue;
+
+				Vector3 positions[3]{ classPositions[pClasses[0]], classPositions[pClasses[1]], classPositions[pClasses[2]] };
+				const Vector3 oldNormal{ Vector3::Cross(positions[1] - positions[0], positions[2] - positions[0]) };
+				for (int corner{}; corner < 3; ++corner)
+				{
+					if (pClasses[corner] == from)
+						positions[corner] = classPositions[to];
+				}
+				const Vector3 newNormal{ Vector3::Cross(positions[1] - positions[0], positions[2] - positions[0]) };
+
+				if (Vector3::Dot(oldNormal, newNormal) <= 0.25f * oldNormal.Magnitude() * newNormal.Magnitude())
+					return false;
+			}
+			return true;
+		};
+
+		//Corners that moved to another position pick the closest matching vertex of their new class
+		auto pickVertex = [&](uint32_t originalVertex, uint32_t targetClass)
+		{
+			if (classOf[originalVertex] == targetClass)
+				return originalVertex;
+
+			const Vertex& original{ mesh.vertices[originalVertex] };
+			uint32_t bestVertex{ classVertices[targetClass][0] };
+			float bestDistance{ FLT_MAX };
+			for (uint32_t candidate : classVertices[targetClass])
+			{
+				const Vertex& vertex{ mesh.vertices[candidate] };
+				const float distance{ (vertex.uv - original.uv).SqrMagnitude() + (vertex.normal - original.normal).SqrMagnitude() };
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestVertex = candidate;
+				}
+			}
+			return bestVertex;
+		};
+
+		mesh.lods.push_back({ mesh.indices, vertexCount, 0.f });
+
+		float maxError{};
+		for (int level{ 1 }; level < levelCount; ++level)
+		{
+			const uint32_t targetTriangleCount{ static_cast<uint32_t>(triangleCount * std::pow(reduction, float(level))) };
+			while (liveTriangleCount > targetTriangleCount && !collapses.empty())
+			{
+				const Collapse collapse{ collapses.top() };
+				collapses.pop();
+
+				if (!isClassAlive[collapse.from] || !isClassAlive[collapse.to] ||
+					versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion)
+					continue;
+
+				if (!isCollapseValid(collapse.from, collapse.to))
+					continue;
+
+				for (uint32_t triangle : classTriangles[collapse.from])
+				{
+					if (!isTriangleAlive[triangle])
+						continue;
+
+					uint32_t* pClasses{ &triangleClasses[3 * size_t(triangle)] };
+					if (pClasses[0] == collapse.to || pClasses[1] == collapse.to || pClasses[2] == collapse.to)
+					{
+						isTriangleAlive[triangle] = false;
+						--liveTriangleCount;
+						continue;
+					}
+
+					*std::find(pClasses, pClasses + 3, collapse.from) = collapse.to;
+					classTriangles[collapse.to].push_back(triangle);
+				}
+				classTriangles[collapse.from].clear();
+
+				quadrics[collapse.to] += quadrics[collapse.from];
+				isClassAlive[collapse.from] = false;
+				++versions[collapse.from];
+				++versions[collapse.to];
+				maxError = std::max(maxError, static_cast<float>(std::sqrt(std::max(collapse.cost, 0.0))));
+
+				//Costs around the surviving vertex changed, queue them again
+				std::vector<uint32_t>& survivorTriangles{ classTriangles[collapse.to] };
+				survivorTriangles.erase(std::remove_if(survivorTriangles.begin(), survivorTriangles.end(),
+					[&](uint32_t triangle) { return !isTriangleAlive[triangle]; }), survivorTriangles.end());
+				for (uint32_t triangle : survivorTriangles)
+				{
+					pushTriangleEdges(triangle);
+				}
+			}
+
+			//Ran out of valid collapses, coarser levels would look the same
+			if (liveTriangleCount > targetTriangleCount)
+				break;
+
+			MeshLOD lod{};
+			lod.geometricError = maxError;
+			lod.indices.reserve(3 * size_t(liveTriangleCount));
+			for (uint32_t triangle{}; triangle < triangleCount; ++triangle)
+			{
+				if (!isTriangleAlive[triangle])
+					continue;
+
+				for (int corner{}; corner < 3; ++corner)
+				{
+					lod.indices.push_back(pickVertex(mesh.indices[3 * size_t(triangle) + corner], triangleClasses[3 * size_t(triangle) + corner]));
+				}
+			}
+			mesh.lods.push_back(std::move(lod));
+		}
+
+		//Sort vertices so the ones used by coarse levels come first, every level then uses a prefix
+		std::vector<int> coarsestLevel(vertexCount, -1);
+		for (int level{}; level < static_cast<int>(mesh.lods.size()); ++level)
+		{
+			for (uint32_t index : mesh.lods[level].indices)
+			{
+				coarsestLevel[index] = std::max(coarsestLevel[index], level);
+			}
+		}
+
+		std::vector<uint32_t> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return coarsestLevel[a] > coarsestLevel[b]; });
+
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<Vertex> sortedVertices(vertexCount);
+		for (uint32_t newIndex{}; newIndex < vertexCount; ++newIndex)
+		{
+			remap[order[newIndex]] = newIndex;
+			sortedVertices[newIndex] = mesh.vertices[order[newIndex]];
+		}
+		mesh.vertices = std::move(sortedVertices);
+
+		for (int level{}; level < static_cast<int>(mesh.lods.size()); ++level)
+		{
+			MeshLOD& lod{ mesh.lods[level] };
+			for (uint32_t& index : lod.indices)
+			{
+				index = remap[index];
+			}
+			lod.vertexCount = static_cast<uint32_t>(std::count_if(coarsestLevel.begin(), coarsestLevel.end(), [level](int coarsest) { return coarsest >= level; }));
+		}
+		mesh.indices = mesh.lods[0].indices;
+	}
+
+	int Utils::SelectLOD(const Mesh& mesh, const Matrix& worldMatrix, const Camera& camera, float screenHeight, float maxPixelError)
+	{
+		if (mesh.lods.size() < 2)
+			return 0;
+
+		//Take the largest axis scale so non-uniform scaling stays conservative
+		const float scale{ std::max(worldMatrix.GetAxisX().Magnitude(), std::max(worldMatrix.GetAxisY().Magnitude(), worldMatrix.GetAxisZ().Magnitude())) };
+		const Vector3 center{ worldMatrix.TransformPoint(mesh.boundsCenter) };
+		const float distance{ (center - camera.origin).Magnitude() - mesh.boundsRadius * scale };
+		if (distance <= camera.near)
+			return 0;
+
+		//Pixels covered by one world unit at that distance, camera.fov holds tan(fovAngle / 2)
+		const float pixelsPerUnit{ screenHeight / (2.f * camera.fov * distance) };
+		for (int level{ static_cast<int>(mesh.lods.size()) - 1 }; level > 0; --level)
+		{
+			if (mesh.lods[level].geometricError * scale * pixelsPerUnit <= maxPixelError)
+				return level;
+		}
+		return 0;
+	}
+}
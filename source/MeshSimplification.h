@@ -0,0 +1,18 @@
+#pragma once
+#include "DataTypes.h"
+
+namespace dae
+{
+	struct Camera;
+
+	namespace Utils
+	{
+		//Builds mesh.lods with quadric error edge-collapse simplification (TriangleList only)
+		//Every level keeps roughly 'reduction' of the triangles of the previous one
+		//Vertices are reordered so that each level only references the first lod.vertexCount vertices
+		void GenerateLODs(Mesh& mesh, int levelCount = 4, float reduction = 0.5f);
+
+		//Picks the coarsest level whose projected geometric error stays below maxPixelError
+		int SelectLOD(const Mesh& mesh, const Matrix& worldMatrix, const Camera& camera, float screenHeight, float maxPixelError = 1.f);
+	}
+}
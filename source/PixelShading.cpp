@@ -0,0 +1,100 @@
+#include "PixelShading.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PixelShadingKernels.h"
+
+namespace dae
+{
+	//Baseline variant, built with the project wide instruction set
+	Utils::PixelKernels Utils::GetPixelKernelsSSE2()
+	{
+		return { &simd::ShadePixelPacket, &simd::ResolveHdr };
+	}
+
+	void Utils::PowReference(float* pBases, const float* pExponents, size_t count)
+	{
+		for (size_t index{}; index < count; ++index)
+		{
+			pBases[index] = std::pow(pBases[index], pExponents[index]);
+		}
+	}
+
+	namespace
+	{
+		Utils::PixelKernels GetActivePixelKernels()
+		{
+			//A packet is exactly one AVX2 register, AVX-512 has nothing to add and SSE4.1 nothing over the baseline
+			return simd::GetActiveIsa() >= simd::Isa::AVX2 ? Utils::GetPixelKernelsAVX2() : Utils::GetPixelKernelsSSE2();
+		}
+	}
+
+	void Utils::ShadePixelPacket(const PixelShaderState& state, PixelPacket& packet)
+	{
+		GetActivePixelKernels().pShadePixelPacket(state, packet);
+	}
+
+	void Utils::ResolveHdr(const HdrResolveState& state, const uint32_t* pHdrPixels, uint32_t* pOutPixels, size_t count)
+	{
+		GetActivePixelKernels().pResolveHdr(state, pHdrPixels, pOutPixels, count);
+	}
+
+	float Utils::MeasureSpecularError(SpecularPrecision precision)
+	{
+		//Same exponent range as the packet shader: an 8 bit gloss texel times the shininess of 25
+		constexpr int glossSteps{ 256 };
+		constexpr int cosineSteps{ 4096 };
+		constexpr float shininess{ 25.f };
+
+		float maxError{};
+		float bases[simd::Width];
+		float exponents[simd::Width];
+		float results[simd::Width];
+		for (int glossStep{}; glossStep < glossSteps; ++glossStep)
+		{
+			const float exponent{ glossStep / 255.f * shininess };
+			for (int cosineStep{}; cosineStep <= cosineSteps; cosineStep += simd::Width)
+			{
+				for (int lane{}; lane < simd::Width; ++lane)
+				{
+					bases[lane] = std::min(cosineStep + lane, cosineSteps) / static_cast<float>(cosineSteps);
+					exponents[lane] = exponent;
+				}
+
+				simd::Store(results, simd::SpecularPower(simd::Load(bases), simd::Load(exponents), precision));
+				for (int lane{}; lane < simd::Width; ++lane)
+				{
+					maxError = std::max(maxError, std::abs(results[lane] - std::pow(bases[lane], exponents[lane])));
+				}
+			}
+		}
+		return maxError;
+	}
+
+	const char* Utils::GetToneMapperName(ToneMapper toneMapper)
+	{
+		switch (toneMapper)
+		{
+		case ToneMapper::Reinhard:
+			return "Reinhard";
+		case ToneMapper::ACES:
+			return "ACES";
+		}
+		return "Unknown";
+	}
+
+	const char* Utils::GetSpecularPrecisionName(SpecularPrecision precision)
+	{
+		switch (precision)
+		{
+		case SpecularPrecision::Reference:
+			return "Reference (std::pow)";
+		case SpecularPrecision::Polynomial:
+			return "Polynomial";
+		case SpecularPrecision::FastPolynomial:
+			return "Fast polynomial";
+		}
+		return "Unknown";
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+
+#include "DataTypes.h"
+#include "Texture.h"
+
+namespace dae
+{
+	//How the packet shader raises cosAlpha to the gloss exponent of the Phong lobe
+	enum class SpecularPrecision
+	{
+		Reference, //std::pow lane by lane
+		Polynomial, //5th degree exp2/log2 fits
+		FastPolynomial //3rd degree fits
+	};
+
+	//How the resolve brings a linear HDR target back to display range
+	enum class ToneMapper
+	{
+		Reinhard,
+		ACES //Narkowicz's fit of the ACES filmic curve
+	};
+
+	//Background of the HDR target, all bits set is an R11G11B10 NaN which no shaded pixel packs to
+	constexpr uint32_t HdrClearValue{ 0xffffffff };
+
+	//Everything Utils::ResolveHdr needs besides the pixels
+	struct HdrResolveState
+	{
+		ToneMapper toneMapper{ ToneMapper::ACES };
+		float exposure{ 1.f };
+		ColorFormat outputFormat{};
+		//Display colour of the pixels that still hold HdrClearValue
+		uint32_t clearColor{};
+	};
+
+	//Pixels of one triangle row in structure-of-arrays form, shaded together by Utils::ShadePixelPacket
+	//Lanes outside activeMask are shaded as well, they only need texture coordinates inside the textures
+	struct PixelPacket
+	{
+		static constexpr int Size{ 8 };
+
+		uint32_t activeMask{};
+
+		//Interpolated varyings, only the ones of the shading mode are read
+		float u[Size]{};
+		float v[Size]{};
+		float normalX[Size]{};
+		float normalY[Size]{};
+		float normalZ[Size]{};
+		float tangentX[Size]{};
+		float tangentY[Size]{};
+		float tangentZ[Size]{};
+		float viewDirectionX[Size]{};
+		float viewDirectionY[Size]{};
+		float viewDirectionZ[Size]{};
+
+		//Shaded colour, scaled down like ColorRGB::MaxToOne and packed in the ColorFormat of the state
+		//or unclamped linear R11G11B10 float when the state has isHdrOutput set
+		uint32_t color[Size]{};
+	};
+
+	//Everything besides the pixels the packet shader reads, constant for every pixel of a triangle
+	struct PixelShaderState
+	{
+		ShadingMode shadingMode{};
+		SpecularPrecision specularPrecision{ SpecularPrecision::Polynomial };
+		bool isNormalMapEnabled{};
+		//Linear R11G11B10 float for Utils::ResolveHdr instead of display colours in outputFormat
+		bool isHdrOutput{};
+		ColorFormat outputFormat{};
+
+		TextureView diffuse{};
+		TextureView normal{};
+		TextureView gloss{};
+		TextureView specular{};
+	};
+
+	namespace Utils
+	{
+		//Packet version of Renderer::RenderPixelInfo, runs the kernel variant of simd::GetActiveIsa()
+		//Gathers the texels of all lanes at once and approximates the specular power with exp2/log2 polynomials
+		void ShadePixelPacket(const PixelShaderState& state, PixelPacket& packet);
+
+		//Tonemaps and sRGB encodes count R11G11B10 float pixels into display colours of state.outputFormat, in and out may overlap
+		void ResolveHdr(const HdrResolveState& state, const uint32_t* pHdrPixels, uint32_t* pOutPixels, size_t count);
+		const char* GetToneMapperName(ToneMapper toneMapper);
+
+		//Largest absolute difference with std::pow over every gloss value of an 8 bit map and cosAlpha in [0, 1]
+		float MeasureSpecularError(SpecularPrecision precision);
+		const char* GetSpecularPrecisionName(SpecularPrecision precision);
+	}
+}
@@ -0,0 +1,10 @@
+//Built with /arch:AVX2 (see Rasterizer.vcxproj), only called when the CPU supports AVX2
+#include "PixelShadingKernels.h"
+
+namespace dae
+{
+	Utils::PixelKernels Utils::GetPixelKernelsAVX2()
+	{
+		return { &simd::ShadePixelPacket, &simd::ResolveHdr };
+	}
+}
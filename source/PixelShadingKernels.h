@@ -0,0 +1,322 @@
+#pragma once
+//Body of the packet shader, included once per instruction set variant (PixelShading*.cpp) like VertexStreamsKernels.h
+//Same rule as there: kernel bodies only call the simd:: wrappers of their own variant, no std:: or MathHelpers.h math
+#include "PixelShading.h"
+#include "SIMD.h"
+
+namespace dae
+{
+	namespace Utils
+	{
+		struct PixelKernels
+		{
+			void (*pShadePixelPacket)(const PixelShaderState& state, PixelPacket& packet);
+			void (*pResolveHdr)(const HdrResolveState& state, const uint32_t* pHdrPixels, uint32_t* pOutPixels, size_t count);
+		};
+
+		PixelKernels GetPixelKernelsSSE2();
+		PixelKernels GetPixelKernelsAVX2();
+
+		//std::pow of every element in place, defined in the baseline translation unit (PixelShading.cpp) for SpecularPrecision::Reference
+		void PowReference(float* pBases, const float* pExponents, size_t count);
+	}
+
+	namespace simd
+	{
+		inline namespace DAE_SIMD_NAMESPACE
+		{
+			//Texture::Sample for every lane, the texel index stays exact in float up to 2^24 texels
+			inline void SampleTexture(const TextureView& texture, Float u, Float v, Float& red, Float& green, Float& blue)
+			{
+				const Float width{ Set1(static_cast<float>(texture.width)) };
+				const Float height{ Set1(static_cast<float>(texture.height)) };
+				const Float column{ IntToFloat(TruncateToInt(Mul(u, width))) };
+				const Float row{ IntToFloat(TruncateToInt(Mul(v, height))) };
+				const Int texels{ GatherUInt32(texture.pPixels, TruncateToInt(Add(Mul(row, width), column))) };
+
+				const Int byteMask{ Set1Int(0xff) };
+				const Float maxByte{ Set1(255.f) };
+				red = Div(IntToFloat(AndInt(ShiftRight(texels, texture.redShift), byteMask)), maxByte);
+				green = Div(IntToFloat(AndInt(ShiftRight(texels, texture.greenShift), byteMask)), maxByte);
+				blue = Div(IntToFloat(AndInt(ShiftRight(texels, texture.blueShift), byteMask)), maxByte);
+			}
+
+			//ColorRGB::MaxToOne, the truncating cast to 8 bit and SDL_MapRGB of a 32 bit surface for every lane
+			inline Int PackColor(const ColorFormat& format, Float red, Float green, Float blue)
+			{
+				//Dividing by one leaves the colours that already fit untouched
+				const Float divisor{ Max(Max(Max(red, green), blue), Set1(1.f)) };
+				const Float maxByte{ Set1(255.f) };
+				const Int redByte{ TruncateToInt(Mul(Div(red, divisor), maxByte)) };
+				const Int greenByte{ TruncateToInt(Mul(Div(green, divisor), maxByte)) };
+				const Int blueByte{ TruncateToInt(Mul(Div(blue, divisor), maxByte)) };
+
+				return OrInt(OrInt(ShiftLeft(redByte, format.redShift), ShiftLeft(greenByte, format.greenShift)),
+					OrInt(ShiftLeft(blueByte, format.blueShift), Set1Int(static_cast<int>(format.alphaMask))));
+			}
+
+			//Small float encodings of R11G11B10: 5 bit exponent with the bias of 15 and a 6 (5 for blue) bit mantissa, no sign
+			//Scaling by 2^-112 moves the float exponent bias of 127 down to 15, so the top bits of the float are the small float
+			inline Int PackR11G11B10(Float red, Float green, Float blue)
+			{
+				const Float zero{ Set1(0.f) };
+				//Largest finite values, exponent 30 and a full mantissa, 6 bits for red and green and 5 for blue
+				//Rounding a larger value would carry into the exponent and store infinity
+				const Float maxValue11{ Set1(65024.f) };
+				const Float maxValue10{ Set1(64512.f) };
+				const Float rebias{ Set1(1.92592994e-34f) };
+
+				auto encode = [&](Float value, Float maxValue, int mantissaShift)
+				{
+					const Int bits{ AsInt(Mul(Min(Max(value, zero), maxValue), rebias)) };
+					//Round to nearest, below maxValue a carry into the exponent is still the correctly rounded value
+					return ShiftRight(AddInt(bits, Set1Int(1 << (mantissaShift - 1))), mantissaShift);
+				};
+
+				return OrInt(OrInt(encode(red, maxValue11, 17), ShiftLeft(encode(green, maxValue11, 17), 11)), ShiftLeft(encode(blue, maxValue10, 18), 22));
+			}
+
+			inline void UnpackR11G11B10(Int packed, Float& red, Float& green, Float& blue)
+			{
+				const Float unbias{ Set1(5.19229686e33f) };
+				const Int elevenBits{ Set1Int(0x7ff) };
+				red = Mul(AsFloat(ShiftLeft(AndInt(packed, elevenBits), 17)), unbias);
+				green = Mul(AsFloat(ShiftLeft(AndInt(ShiftRight(packed, 11), elevenBits), 17)), unbias);
+				blue = Mul(AsFloat(ShiftLeft(ShiftRight(packed, 22), 18)), unbias);
+			}
+
+			inline Float ToneMap(Float value, ToneMapper toneMapper)
+			{
+				const Float one{ Set1(1.f) };
+				switch (toneMapper)
+				{
+				case ToneMapper::Reinhard:
+					return Div(value, Add(value, one));
+				case ToneMapper::ACES:
+				default:
+				{
+					const Float numerator{ Mul(value, Add(Mul(Set1(2.51f), value), Set1(0.03f))) };
+					const Float denominator{ Add(Mul(value, Add(Mul(Set1(2.43f), value), Set1(0.59f))), Set1(0.14f)) };
+					return Min(Max(Div(numerator, denominator), Set1(0.f)), one);
+				}
+				}
+			}
+
+			//Linear [0, 1] to the sRGB transfer curve
+			inline Float EncodeSrgb(Float value)
+			{
+				const Float linear{ Mul(value, Set1(12.92f)) };
+				const Float curve{ Sub(Mul(Set1(1.055f), Pow(value, Set1(1.f / 2.4f))), Set1(0.055f)) };
+				return Select(Greater(value, Set1(0.0031308f)), curve, linear);
+			}
+
+			inline Float SpecularPower(Float cosAlpha, Float exponent, SpecularPrecision precision)
+			{
+				switch (precision)
+				{
+				case SpecularPrecision::Reference:
+				{
+					float bases[Width];
+					float exponents[Width];
+					Store(bases, cosAlpha);
+					Store(exponents, exponent);
+					Utils::PowReference(bases, exponents, Width);
+					return Load(bases);
+				}
+				case SpecularPrecision::FastPolynomial:
+					return Pow<true>(cosAlpha, exponent);
+				case SpecularPrecision::Polynomial:
+				default:
+					return Pow(cosAlpha, exponent);
+				}
+			}
+
+			inline void ShadePixelPacket(const PixelShaderState& state, PixelPacket& packet)
+			{
+				static_assert(PixelPacket::Size % Width == 0, "A packet has to be a whole number of registers");
+
+				//Same light as Renderer::RenderPixelInfo, pointing from the surface towards the light
+				const Float toLightX{ Set1(-0.577f) };
+				const Float toLightY{ Set1(0.577f) };
+				const Float toLightZ{ Set1(-0.577f) };
+				const Float lightIntensity{ Set1(7.f) };
+				const Float shininess{ Set1(25.f) };
+				const Float ambient{ Set1(0.025f) };
+				//PI of MathHelpers.h
+				const Float pi{ Set1(3.14159265358979323846f) };
+				const Float zero{ Set1(0.f) };
+				const Float one{ Set1(1.f) };
+				const Float two{ Set1(2.f) };
+
+				for (int offset{}; offset < PixelPacket::Size; offset += Width)
+				{
+					const Float u{ Load(&packet.u[offset]) };
+					const Float v{ Load(&packet.v[offset]) };
+					Float normalX{ Load(&packet.normalX[offset]) };
+					Float normalY{ Load(&packet.normalY[offset]) };
+					Float normalZ{ Load(&packet.normalZ[offset]) };
+
+					//Normal map, tangent space rows are tangent, binormal and normal
+					if (state.isNormalMapEnabled)
+					{
+						const Float tangentX{ Load(&packet.tangentX[offset]) };
+						const Float tangentY{ Load(&packet.tangentY[offset]) };
+						const Float tangentZ{ Load(&packet.tangentZ[offset]) };
+
+						Float binormalX{ Sub(Mul(normalY, tangentZ), Mul(normalZ, tangentY)) };
+						Float binormalY{ Sub(Mul(normalZ, tangentX), Mul(normalX, tangentZ)) };
+						Float binormalZ{ Sub(Mul(normalX, tangentY), Mul(normalY, tangentX)) };
+						Normalize(binormalX, binormalY, binormalZ);
+
+						Float sampleX{};
+						Float sampleY{};
+						Float sampleZ{};
+						SampleTexture(state.normal, u, v, sampleX, sampleY, sampleZ);
+						sampleX = Sub(Mul(two, sampleX), one);
+						sampleY = Sub(Mul(two, sampleY), one);
+						sampleZ = Sub(Mul(two, sampleZ), one);
+
+						Float mappedX{ Add(Add(Mul(sampleX, tangentX), Mul(sampleY, binormalX)), Mul(sampleZ, normalX)) };
+						Float mappedY{ Add(Add(Mul(sampleX, tangentY), Mul(sampleY, binormalY)), Mul(sampleZ, normalY)) };
+						Float mappedZ{ Add(Add(Mul(sampleX, tangentZ), Mul(sampleY, binormalZ)), Mul(sampleZ, normalZ)) };
+						Normalize(mappedX, mappedY, mappedZ);
+
+						normalX = mappedX;
+						normalY = mappedY;
+						normalZ = mappedZ;
+					}
+
+					const Float lambertCosine{ Add(Add(Mul(normalX, toLightX), Mul(normalY, toLightY)), Mul(normalZ, toLightZ)) };
+
+					//Phong lobe tinted by the specular map, the gloss map scales the exponent
+					auto samplePhong = [&](Float& red, Float& green, Float& blue)
+					{
+						Float gloss{};
+						Float unusedGreen{};
+						Float unusedBlue{};
+						SampleTexture(state.gloss, u, v, gloss, unusedGreen, unusedBlue);
+						SampleTexture(state.specular, u, v, red, green, blue);
+
+						const Float twoCosine{ Mul(two, lambertCosine) };
+						const Float reflectX{ Sub(toLightX, Mul(twoCosine, normalX)) };
+						const Float reflectY{ Sub(toLightY, Mul(twoCosine, normalY)) };
+						const Float reflectZ{ Sub(toLightZ, Mul(twoCosine, normalZ)) };
+
+						const Float viewDirectionX{ Load(&packet.viewDirectionX[offset]) };
+						const Float viewDirectionY{ Load(&packet.viewDirectionY[offset]) };
+						const Float viewDirectionZ{ Load(&packet.viewDirectionZ[offset]) };
+						const Float cosAlpha{ Max(zero, Add(Add(Mul(reflectX, viewDirectionX), Mul(reflectY, viewDirectionY)), Mul(reflectZ, viewDirectionZ))) };
+
+						const Float phong{ SpecularPower(cosAlpha, Mul(gloss, shininess), state.specularPrecision) };
+						red = Mul(red, phong);
+						green = Mul(green, phong);
+						blue = Mul(blue, phong);
+					};
+
+					Float red{ zero };
+					Float green{ zero };
+					Float blue{ zero };
+					switch (state.shadingMode)
+					{
+					case ShadingMode::Combined:
+					{
+						SampleTexture(state.diffuse, u, v, red, green, blue);
+						Float phongRed{};
+						Float phongGreen{};
+						Float phongBlue{};
+						samplePhong(phongRed, phongGreen, phongBlue);
+
+						const Float diffuseScale{ Mul(lambertCosine, lightIntensity) };
+						red = Add(Mul(diffuseScale, Div(red, pi)), Add(phongRed, ambient));
+						green = Add(Mul(diffuseScale, Div(green, pi)), Add(phongGreen, ambient));
+						blue = Add(Mul(diffuseScale, Div(blue, pi)), Add(phongBlue, ambient));
+					}
+					break;
+					case ShadingMode::Diffuse:
+					{
+						SampleTexture(state.diffuse, u, v, red, green, blue);
+						red = Mul(Mul(lightIntensity, Div(red, pi)), lambertCosine);
+						green = Mul(Mul(lightIntensity, Div(green, pi)), lambertCosine);
+						blue = Mul(Mul(lightIntensity, Div(blue, pi)), lambertCosine);
+					}
+					break;
+					case ShadingMode::Specular:
+					{
+						samplePhong(red, green, blue);
+						red = Mul(Mul(lightIntensity, red), lambertCosine);
+						green = Mul(Mul(lightIntensity, green), lambertCosine);
+						blue = Mul(Mul(lightIntensity, blue), lambertCosine);
+					}
+					break;
+					case ShadingMode::ObservedArea:
+					default:
+					{
+						red = lambertCosine;
+						green = lambertCosine;
+						blue = lambertCosine;
+					}
+					break;
+					}
+
+					//Surfaces facing away from the light stay black
+					const Mask isLit{ Greater(lambertCosine, zero) };
+					red = Select(isLit, red, zero);
+					green = Select(isLit, green, zero);
+					blue = Select(isLit, blue, zero);
+
+					StoreInt(&packet.color[offset], state.isHdrOutput ? PackR11G11B10(red, green, blue) : PackColor(state.outputFormat, red, green, blue));
+				}
+			}
+
+			inline Int ResolveHdrPixels(const HdrResolveState& state, Int hdr)
+			{
+				const Float exposure{ Set1(state.exposure) };
+				const Float maxByte{ Set1(255.f) };
+
+				Float red{};
+				Float green{};
+				Float blue{};
+				UnpackR11G11B10(hdr, red, green, blue);
+
+				auto encode = [&](Float value)
+				{
+					return RoundToInt(Mul(EncodeSrgb(ToneMap(Mul(value, exposure), state.toneMapper)), maxByte));
+				};
+
+				const ColorFormat& format{ state.outputFormat };
+				const Int color{ OrInt(OrInt(ShiftLeft(encode(red), format.redShift), ShiftLeft(encode(green), format.greenShift)),
+					OrInt(ShiftLeft(encode(blue), format.blueShift), Set1Int(static_cast<int>(format.alphaMask)))) };
+
+				//Background keeps the exact clear colour
+				const Mask isBackground{ EqualInt(hdr, Set1Int(static_cast<int>(HdrClearValue))) };
+				return AsInt(Select(isBackground, AsFloat(Set1Int(static_cast<int>(state.clearColor))), AsFloat(color)));
+			}
+
+			inline void ResolveHdr(const HdrResolveState& state, const uint32_t* pHdrPixels, uint32_t* pOutPixels, size_t count)
+			{
+				size_t offset{};
+				for (; offset + Width <= count; offset += Width)
+				{
+					StoreInt(pOutPixels + offset, ResolveHdrPixels(state, LoadInt(pHdrPixels + offset)));
+				}
+
+				//The tail goes through a full register of background pixels, plain loops since the std algorithms
+				//would be shared with translation units built for other instruction sets
+				if (offset < count)
+				{
+					const size_t tailCount{ count - offset };
+					uint32_t pixels[Width];
+					for (size_t lane{}; lane < Width; ++lane)
+					{
+						pixels[lane] = lane < tailCount ? pHdrPixels[offset + lane] : HdrClearValue;
+					}
+					StoreInt(pixels, ResolveHdrPixels(state, LoadInt(pixels)));
+					for (size_t lane{}; lane < tailCount; ++lane)
+					{
+						pOutPixels[offset + lane] = pixels[lane];
+					}
+				}
+			}
+		}
+	}
+}
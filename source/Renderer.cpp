@@ -8,12 +8,18 @@
 #include "Matrix.h"
 #include "Texture.h"
 #include "Utils.h"
-#include <iostream>
+#include "MeshSimplification.h"
+#include "Frustum.h"
+#include "VertexStreams.h"
+#include "SIMD.h"
+#include "Log.h"
+#include <cstring>
 
 using namespace dae;
 
-Renderer::Renderer(SDL_Window* pWindow) :
+Renderer::Renderer(SDL_Window* pWindow, JobSystem* pJobSystem) :
 	m_pWindow(pWindow)
+	, m_pJobSystem{ pJobSystem }
 	, m_Vertices{}
 	, m_Indices{}
 	, m_RotationMatrix{}
@@ -24,16 +30,34 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
 
 	//Create Buffers
-	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
-	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
+	m_pPresenter = new FramePresenter(pWindow, m_Width, m_Height);
+	m_pScreenshotWriter = new ScreenshotWriter();
+	m_pBackBuffer = m_pPresenter->GetTarget(m_BackBufferIndex);
 	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
-
-	m_pDepthBufferPixels = new float[m_Width * m_Height];
+	m_BackBufferFormat = { m_pBackBuffer->format->Rshift, m_pBackBuffer->format->Gshift, m_pBackBuffer->format->Bshift, m_pBackBuffer->format->Amask };
+
+	m_TiledWidth = (m_Width + m_MemoryTileSize - 1) & ~(m_MemoryTileSize - 1);
+	m_TiledHeight = (m_Height + m_MemoryTileSize - 1) & ~(m_MemoryTileSize - 1);
+	const size_t tiledPixelCount{ static_cast<size_t>(m_TiledWidth) * m_TiledHeight };
+	m_pDepthBufferPixels = new float[tiledPixelCount];
+	m_pColorPixels = new uint32_t[tiledPixelCount];
+	m_pHdrPixels = new uint32_t[tiledPixelCount];
+	//Unorm24 and Unorm16 share it, 3 bytes per pixel fit both
+	m_CompactDepthBuffer.resize(tiledPixelCount * 3);
+
+	m_ClearColor = SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100);
+	m_HdrResolveState.outputFormat = m_BackBufferFormat;
+	m_HdrResolveState.clearColor = m_ClearColor;
+	m_ClearTileCountX = (m_Width + m_ClearTileSize - 1) / m_ClearTileSize;
+	m_ClearTileCountY = (m_Height + m_ClearTileSize - 1) / m_ClearTileSize;
+	m_TileHasClearColor.assign(m_pPresenter->GetTargetCount(), std::vector<uint8_t>(m_ClearTileCountX * m_ClearTileCountY, 0));
 
 	//Initialize Camera
 	m_Camera.Initialize(60.f, { .0f,5.0f,-30.f }, (float)m_Width / (float)m_Height);
 
-	m_pTexture = Texture::LoadFromFile("Resources/tuktuk.png");
+	//Assets load as jobs, the mesh steps depend on each other and the textures on nothing
+	std::vector<JobSystem::JobHandle> loadJobs{};
+	loadJobs.push_back(m_pJobSystem->Schedule([this] { m_pTexture = Texture::LoadFromFile("Resources/tuktuk.png"); }));
 
 	/*Mesh tuktuk{};
 
@@ -48,30 +72,55 @@ Renderer::Renderer(SDL_Window* pWindow) :
 
 	Mesh vehicle{};
 
-	Utils::ParseOBJ("Resources/vehicle.obj", m_Vertices, m_Indices);
-
-	vehicle.vertices = m_Vertices;
-	vehicle.indices = m_Indices;
-	vehicle.primitiveTopology = PrimitiveTopology::TriangleList;
-
-	//Matrices for mesh worldMatrix
-	Matrix scaleMatrix{ Matrix::CreateScale({1,1,1}) };
-	Matrix rotateMatrix{ Matrix::CreateRotationY(90.f * TO_RADIANS) };
-	Matrix translateMatrix{ Matrix::CreateTranslation({0,0,50}) };
+	const JobSystem::JobHandle parseJob{ m_pJobSystem->Schedule([this, &vehicle]
+		{
+			Utils::ParseOBJ("Resources/vehicle.obj", m_Vertices, m_Indices);
+
+			vehicle.vertices = m_Vertices;
+			vehicle.indices = m_Indices;
+			vehicle.primitiveTopology = PrimitiveTopology::TriangleList;
+		}) };
+	const JobSystem::JobHandle lodJob{ m_pJobSystem->Schedule([&vehicle] { Utils::GenerateLODs(vehicle); }, { parseJob }) };
+	loadJobs.push_back(m_pJobSystem->Schedule([&vehicle] { Utils::BuildVertexStreams(vehicle); }, { lodJob }));
+
+	loadJobs.push_back(m_pJobSystem->Schedule([this] { m_pVehicleDiffuse = Texture::LoadFromFile("Resources/vehicle_diffuse.png"); }));
+	loadJobs.push_back(m_pJobSystem->Schedule([this] { m_pVehicleNormal = Texture::LoadFromFile("Resources/vehicle_normal.png"); }));
+	loadJobs.push_back(m_pJobSystem->Schedule([this] { m_pVehicleGlossy = Texture::LoadFromFile("Resources/vehicle_gloss.png"); }));
+	loadJobs.push_back(m_pJobSystem->Schedule([this] { m_pVehicleSpecular = Texture::LoadFromFile("Resources/vehicle_specular.png"); }));
+
+	//Matrices for the instance worldMatrix, all folded at compile time
+	constexpr Matrix scaleMatrix{ Matrix::CreateScale({1,1,1}) };
+	constexpr Matrix rotateMatrix{ Matrix::CreateRotationY(90.f * TO_RADIANS) };
+	constexpr Matrix translateMatrix{ Matrix::CreateTranslation({0,0,50}) };
+
+	m_pJobSystem->Wait(loadJobs);
+	m_Meshes.push_back(vehicle);
 
-	vehicle.worldMatrix = scaleMatrix * rotateMatrix * translateMatrix;
+	m_Materials.push_back({ m_pVehicleDiffuse, m_pVehicleNormal, m_pVehicleGlossy, m_pVehicleSpecular });
 
-	m_Meshes.push_back(vehicle);
+	//Instances only reference the mesh and material, add more of them to draw a fleet
+	constexpr Matrix vehicleWorldMatrix{ scaleMatrix * rotateMatrix * translateMatrix };
+	m_Instances.push_back({ 0, 0, vehicleWorldMatrix });
 
-	m_pVehicleDiffuse = Texture::LoadFromFile("Resources/vehicle_diffuse.png");
-	m_pVehicleNormal = Texture::LoadFromFile("Resources/vehicle_normal.png");
-	m_pVehicleGlossy = Texture::LoadFromFile("Resources/vehicle_gloss.png");
-	m_pVehicleSpecular = Texture::LoadFromFile("Resources/vehicle_specular.png");
+	std::vector<AABB> instanceBounds{};
+	instanceBounds.reserve(m_Instances.size());
+	for (const MeshInstance& instance : m_Instances)
+	{
+		instanceBounds.push_back(TransformAABB(m_Meshes[instance.meshIndex].bounds, instance.worldMatrix));
+	}
+	m_SceneBVH.Build(instanceBounds);
 }
 
 Renderer::~Renderer()
 {
+	//Shows the frames that are still queued and stops the present thread before anything else goes away
+	delete m_pPresenter;
+	StopFrameSequence();
+	delete m_pScreenshotWriter;
+
 	delete[] m_pDepthBufferPixels;
+	delete[] m_pColorPixels;
+	delete[] m_pHdrPixels;
 
 	if (m_pTexture)
 		delete m_pTexture;
@@ -92,11 +141,30 @@ void Renderer::Update(Timer* pTimer)
 
 	const float rotationSpeed{ 25.f };
 	m_RotationMatrix = Matrix::CreateRotationY((rotationSpeed * pTimer->GetElapsed()) * TO_RADIANS);
+
+	if (m_IsRotating)
+	{
+		//Spin every instance around its own origin and refit its path in the hierarchy
+		for (uint32_t index{}; index < m_Instances.size(); ++index)
+		{
+			MeshInstance& instance{ m_Instances[index] };
+			instance.worldMatrix = m_RotationMatrix * instance.worldMatrix;
+			m_SceneBVH.UpdateObject(index, TransformAABB(m_Meshes[instance.meshIndex].bounds, instance.worldMatrix));
+		}
+	}
 }
 
 void Renderer::Render()
 {
 	//@START
+	//Everything the last frame allocated for itself is released at once
+	m_FrameArena.Reset();
+
+	//Render in a target the present thread isn't reading, this only waits when all the others are still queued
+	m_BackBufferIndex = m_pPresenter->AcquireTarget();
+	m_pBackBuffer = m_pPresenter->GetTarget(m_BackBufferIndex);
+	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+
 	//Lock BackBuffer
 	SDL_LockSurface(m_pBackBuffer);
 
@@ -118,10 +186,11 @@ void Renderer::Render()
 	Render_W3_Vehicle();
 
 	//@END
-	//Update SDL Surface
+	//Blit + window update happen on the present thread while the next frame renders
 	SDL_UnlockSurface(m_pBackBuffer);
-	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-	SDL_UpdateWindowSurface(m_pWindow);
+	if (m_pSequenceWriter)
+		m_pSequenceWriter->SubmitFrame(m_pBackBufferPixels);
+	m_pPresenter->SubmitTarget(m_BackBufferIndex);
 }
 
 void dae::Renderer::Render_W1_Gradient()
@@ -540,8 +609,6 @@ void dae::Renderer::Render_W2_TriangleStrip()
 		}
 	};
 
-	VertexTransformationFunction(meshes_World);
-
 	ColorRGB finalColor{ 0.f, 0.f, 0.f };
 
 	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
@@ -550,13 +617,16 @@ void dae::Renderer::Render_W2_TriangleStrip()
 	//RENDER LOGIC
 	for (Mesh& mesh : meshes_World)
 	{
+		std::vector<Vertex_Out> vertices_out{};
+		VertexTransformationFunction(mesh, Matrix{}, vertices_out);
+
 		//mesh.indices
 		for (int i = 0; i < mesh.indices.size() - 2; ++i)
 		{
 			std::vector<Vertex_Out> triangle{
-					mesh.vertices_out[mesh.indices[i]],
-					mesh.vertices_out[mesh.indices[i + 1]],
-					mesh.vertices_out[mesh.indices[i + 2]]
+					vertices_out[mesh.indices[i]],
+					vertices_out[mesh.indices[i + 1]],
+					vertices_out[mesh.indices[i + 2]]
 			};
 
 			if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
@@ -713,8 +783,6 @@ void dae::Renderer::Render_W2_TriangleList()
 		}
 	};
 
-	VertexTransformationFunction(meshes_World);
-
 	ColorRGB finalColor{ 0.f, 0.f, 0.f };
 
 	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
@@ -723,13 +791,16 @@ void dae::Renderer::Render_W2_TriangleList()
 	//RENDER LOGIC
 	for (Mesh& mesh : meshes_World)
 	{
+		std::vector<Vertex_Out> vertices_out{};
+		VertexTransformationFunction(mesh, Matrix{}, vertices_out);
+
 		//mesh.indices
 		for (int i = 0; i < mesh.indices.size(); i += 3)
 		{
 			std::vector<Vertex_Out> triangle{
-					mesh.vertices_out[mesh.indices[i]],
-					mesh.vertices_out[mesh.indices[i + 1]],
-					mesh.vertices_out[mesh.indices[i + 2]]
+					vertices_out[mesh.indices[i]],
+					vertices_out[mesh.indices[i + 1]],
+					vertices_out[mesh.indices[i + 2]]
 			};
 
 			const Vector2 v0{ triangle[0].position.x, triangle[0].position.y };
@@ -868,8 +939,6 @@ void dae::Renderer::Render_W2_Textures()
 		}
 	};
 
-	VertexTransformationFunction(meshes_World);
-
 	ColorRGB finalColor{ 0.f, 0.f, 0.f };
 
 	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
@@ -880,13 +949,16 @@ void dae::Renderer::Render_W2_Textures()
 	//RENDER LOGIC
 	for (Mesh& mesh : meshes_World)
 	{
+		std::vector<Vertex_Out> vertices_out{};
+		VertexTransformationFunction(mesh, Matrix{}, vertices_out);
+
 		//mesh.indices
 		for (int i = 0; i < mesh.indices.size() - 2; ++i)
 		{
 			std::vector<Vertex_Out> triangle{
-					mesh.vertices_out[mesh.indices[i]],
-					mesh.vertices_out[mesh.indices[i + 1]],
-					mesh.vertices_out[mesh.indices[i + 2]]
+					vertices_out[mesh.indices[i]],
+					vertices_out[mesh.indices[i + 1]],
+					vertices_out[mesh.indices[i + 2]]
 			};
 
 			if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
@@ -1046,8 +1118,6 @@ void dae::Renderer::Render_W2_DepthInterpolation()
 		}
 	};
 
-	VertexTransformationFunction(meshes_World);
-
 	ColorRGB finalColor{ 0.f, 0.f, 0.f };
 
 	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
@@ -1056,13 +1126,16 @@ void dae::Renderer::Render_W2_DepthInterpolation()
 	//RENDER LOGIC
 	for (Mesh& mesh : meshes_World)
 	{
+		std::vector<Vertex_Out> vertices_out{};
+		VertexTransformationFunction(mesh, Matrix{}, vertices_out);
+
 		//mesh.indices
 		for (int i = 0; i < mesh.indices.size() - 2; ++i)
 		{
 			std::vector<Vertex_Out> triangle{
-					mesh.vertices_out[mesh.indices[i]],
-					mesh.vertices_out[mesh.indices[i + 1]],
-					mesh.vertices_out[mesh.indices[i + 2]]
+					vertices_out[mesh.indices[i]],
+					vertices_out[mesh.indices[i + 1]],
+					vertices_out[mesh.indices[i + 2]]
 			};
 
 			if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
@@ -1189,9 +1262,6 @@ void dae::Renderer::Render_W3_Projection()
 		}
 	};
 
-	VertexTransformationFunction(meshes_World);
-
-
 	ColorRGB finalColor{ 0.f, 0.f, 0.f };
 
 	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
@@ -1200,12 +1270,15 @@ void dae::Renderer::Render_W3_Projection()
 	//RENDER LOGIC
 	for (Mesh& mesh : meshes_World)
 	{
+		std::vector<Vertex_Out> vertices_out{};
+		VertexTransformationFunction(mesh, Matrix{}, vertices_out);
+
 		for (int i = 0; i < mesh.indices.size() - 2; ++i)
 		{
 			std::vector<Vertex_Out> triangle{
-					mesh.vertices_out[mesh.indices[i]],
-					mesh.vertices_out[mesh.indices[i + 1]],
-					mesh.vertices_out[mesh.indices[i + 2]]
+					vertices_out[mesh.indices[i]],
+					vertices_out[mesh.indices[i + 1]],
+					vertices_out[mesh.indices[i + 2]]
 			};
 
 			if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
@@ -1348,23 +1421,24 @@ void dae::Renderer::Render_W3_Tuktuk()
 {
 	//Projection matrix + depth buffer
 
-	VertexTransformationFunction(m_Meshes);
-
 	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
 	SDL_FillRect(m_pBackBuffer, &m_pBackBuffer->clip_rect, SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100));
 
-	for (Mesh& mesh : m_Meshes)
+	for (const MeshInstance& instance : m_Instances)
 	{
+		const Mesh& mesh{ m_Meshes[instance.meshIndex] };
+		VertexTransformationFunction(mesh, instance.worldMatrix, m_VerticesOut);
+
 		int size = 0;
-		std::vector<Vertex_Out> transformedVertices{ mesh.vertices_out };
+		const std::vector<Vertex_Out>& transformedVertices{ m_VerticesOut };
 
 		if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
 		{
-			size = (int)m_Indices.size();
+			size = (int)mesh.indices.size();
 		}
 		else if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
 		{
-			size = (int)m_Indices.size() - 2;
+			size = (int)mesh.indices.size() - 2;
 		}
 
 		for (int i = 0; i < size;)
@@ -1374,9 +1448,9 @@ void dae::Renderer::Render_W3_Tuktuk()
 			{
 				evenIndex = i % 2;
 			}
-			int index0{ (int)m_Indices[i] };
-			int index1{ (int)m_Indices[i + 1 + evenIndex] };
-			int index2{ (int)m_Indices[i + 2 - evenIndex] };
+			int index0{ (int)mesh.indices[i] };
+			int index1{ (int)mesh.indices[i + 1 + evenIndex] };
+			int index2{ (int)mesh.indices[i + 2 - evenIndex] };
 
 			//Increase i based on primitiveTopology
 			if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
@@ -1520,25 +1594,70 @@ void dae::Renderer::Render_W3_Tuktuk()
 
 void dae::Renderer::Render_W3_Vehicle()
 {
-	//Transform vertices into raster space (world -> camera -> NDC -> raster)
-	VertexTransformationFunction(m_Meshes);
+	//Depth and colour are cleared per tile on first touch instead of up front
+	BeginLazyClear();
 
-	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
-	SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100));
+	//Attributes the current pixel shader reads, the vertex stage and the interpolation skip the rest
+	const uint32_t varyings{ GetPixelShaderVaryings() };
+
+	//Skip whole instances outside of the view frustum before any vertex work
+	const Frustum frustum{ Frustum::Extract(m_Camera.viewMatrix * m_Camera.projectionMatrix) };
+	m_SceneBVH.Cull(frustum, m_VisibleInstances);
 
-	for (Mesh& mesh : m_Meshes)
+	//Lay out the vertex work of every visible instance in one shared output buffer
+	m_VertexBatches.clear();
+	size_t totalVertexCount{};
+	size_t maxTriangleCount{};
+	for (uint32_t instanceIndex : m_VisibleInstances)
 	{
+		const MeshInstance& instance{ m_Instances[instanceIndex] };
+		const Mesh& mesh{ m_Meshes[instance.meshIndex] };
+
+		VertexBatch batch{};
+		batch.pMesh = &mesh;
+		batch.pInstance = &instance;
+
+		//Pick the detail level from the projected error of this instance on screen
+		batch.lod = Utils::SelectLOD(mesh, instance.worldMatrix, m_Camera, (float)m_Height, m_LODPixelError);
+
+		//Coarser LODs only reference a prefix of the vertex buffer
+		batch.vertexCount = mesh.lods.empty() ? mesh.streams.count : mesh.lods[batch.lod].vertexCount;
+		batch.firstVertex = totalVertexCount;
+		totalVertexCount += simd::PaddedCount(batch.vertexCount);
+
+		const size_t indexCount{ mesh.lods.empty() ? mesh.indices.size() : mesh.lods[batch.lod].indices.size() };
+		maxTriangleCount += mesh.primitiveTopology == PrimitiveTopology::TriangleStrip ? std::max(indexCount, size_t{ 2 }) - 2 : indexCount / 3;
+
+		m_VertexBatches.push_back(batch);
+	}
+
+	//Phase one: positions into raster space (world -> camera -> NDC -> raster)
+	VertexTransformationFunction(m_VertexBatches, totalVertexCount, m_VertexStreamsOut);
+
+	//Triangle setup on the positions alone, remember the survivors and which vertex registers they touch
+	//Both only live during this frame, so they come from the frame arena
+	VisibleTriangle* pVisibleTriangles{ m_FrameArena.Allocate<VisibleTriangle>(maxTriangleCount) };
+	size_t visibleTriangleCount{};
+	//One entry per simd::MaxWidth vertices of the output, set when a visible triangle uses one of them
+	uint8_t* pVertexBlockMask{ m_FrameArena.Allocate<uint8_t>(totalVertexCount / simd::MaxWidth) };
+	std::fill_n(pVertexBlockMask, totalVertexCount / simd::MaxWidth, uint8_t{});
+	for (uint32_t batchIndex{}; batchIndex < m_VertexBatches.size(); ++batchIndex)
+	{
+		const VertexBatch& batch{ m_VertexBatches[batchIndex] };
+		const Mesh& mesh{ *batch.pMesh };
+		const int lod{ batch.lod };
+
 		//Change how the for loop advances based on the primitive topology
 		int size = 0;
-		std::vector<Vertex_Out> transformedVertices{ mesh.vertices_out };
+		const std::vector<uint32_t>& indices{ mesh.lods.empty() ? mesh.indices : mesh.lods[lod].indices };
 
 		if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
 		{
-			size = (int)m_Indices.size();
+			size = (int)indices.size();
 		}
 		else if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
 		{
-			size = (int)m_Indices.size() - 2;
+			size = (int)indices.size() - 2;
 		}
 
 		for (int i = 0; i < size;)
@@ -1548,9 +1667,9 @@ void dae::Renderer::Render_W3_Vehicle()
 			{
 				evenIndex = i % 2;
 			}
-			int index0{ (int)m_Indices[i] };
-			int index1{ (int)m_Indices[i + 1 + evenIndex] };
-			int index2{ (int)m_Indices[i + 2 - evenIndex] };
+			int index0{ (int)indices[i] };
+			int index1{ (int)indices[i + 1 + evenIndex] };
+			int index2{ (int)indices[i + 2 - evenIndex] };
 
 			//Increase i based on primitiveTopology
 			if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
@@ -1563,9 +1682,9 @@ void dae::Renderer::Render_W3_Vehicle()
 			}
 
 			//Calculate the points of the triangle
-			Vector4 v0{ transformedVertices[index0].position };
-			Vector4 v1{ transformedVertices[index1].position };
-			Vector4 v2{ transformedVertices[index2].position };
+			const Vector4 v0{ GatherPosition(m_VertexStreamsOut, batch.firstVertex + index0) };
+			const Vector4 v1{ GatherPosition(m_VertexStreamsOut, batch.firstVertex + index1) };
+			const Vector4 v2{ GatherPosition(m_VertexStreamsOut, batch.firstVertex + index2) };
 
 			//Frustum Culling
 			if (v0.x < -1.0f || v0.x > 1.0f || v0.y < -1.0f || v0.y > 1.0f || v0.z < 0.0f || v0.z > 1.0f ||
@@ -1575,157 +1694,226 @@ void dae::Renderer::Render_W3_Vehicle()
 				continue;
 			}
 
-			//Pre-calculate value for the depth buffer -> depth buffer will not be linear anymore
-			float v0InvDepth{ 1 / v0.w };
-			float v1InvDepth{ 1 / v1.w };
-			float v2InvDepth{ 1 / v2.w };
-
-			//Convert from NDC to raster space
-			//Go from [-1,1] range to [0,1] range, taking screen size into acount
-			v0.x = ((v0.x + 1) / 2.0f) * m_Width;
-			v0.y = ((1 - v0.y) / 2.0f) * m_Height;
+			pVisibleTriangles[visibleTriangleCount++] = { batchIndex, { (uint32_t)index0, (uint32_t)index1, (uint32_t)index2 } };
+			pVertexBlockMask[(batch.firstVertex + index0) / simd::MaxWidth] = 1;
+			pVertexBlockMask[(batch.firstVertex + index1) / simd::MaxWidth] = 1;
+			pVertexBlockMask[(batch.firstVertex + index2) / simd::MaxWidth] = 1;
+		}
+	}
 
-			v1.x = ((v1.x + 1) / 2.0f) * m_Width;
-			v1.y = ((1 - v1.y) / 2.0f) * m_Height;
+	//Phase two: normals, tangents and view directions only for vertices of surviving triangles
+	VertexAttributeFunction(m_VertexBatches, totalVertexCount, pVertexBlockMask, varyings, m_VertexStreamsOut);
 
-			v2.x = ((v2.x + 1) / 2.0f) * m_Width;
-			v2.y = ((1 - v2.y) / 2.0f) * m_Height;
+	//Pixels that pass the depth test wait in a packet until it is full, so small triangles still fill every lane
+	PixelPacket packet{};
+	uint32_t packetPixels[PixelPacket::Size]{};
+	int packetCount{};
+	PixelShaderState shaderState{};
+	const Material* pShaderMaterial{};
 
+	//Interpolated directions are renormalized exactly unless the fast approximation was asked for
+	const bool isFastNormalizeEnabled{ m_IsFastNormalizeEnabled };
+	auto normalize = [isFastNormalizeEnabled](Vector3& direction)
+		{
+			if (isFastNormalizeEnabled)
+				direction.NormalizeFast();
+			else
+				direction.Normalize();
+		};
 
-			//Calculate the bounding box
-			float xMin = std::min(std::min(v0.x, v1.x), v2.x);
-			float xMax = std::max(std::max(v0.x, v1.x), v2.x);
+	auto shadePacket = [&]()
+		{
+			if (packetCount == 0)
+				return;
 
-			float yMin = std::min(std::min(v0.y, v1.y), v2.y);
-			float yMax = std::max(std::max(v0.y, v1.y), v2.y);
+			//Render the pixels, unused lanes still hold the valid inputs of an earlier packet
+			packet.activeMask = (1u << packetCount) - 1;
+			Utils::ShadePixelPacket(shaderState, packet);
 
-			//Use the min and max values of the bounding box to loop over the pixels
-			for (int py{ (int)yMin }; py < yMax; ++py)
+			//Update Color in Buffer, lanes are written in the order they were added so a closer pixel added later still wins
+			uint32_t* pTargetPixels{ m_IsHdrEnabled ? m_pHdrPixels : m_pColorPixels };
+			for (int lane{}; lane < packetCount; ++lane)
 			{
-				for (int px{ (int)xMin }; px < xMax; ++px)
-				{
-					ColorRGB finalColor{ 0.f, 0.f, 0.f };
+				pTargetPixels[packetPixels[lane]] = packet.color[lane];
+			}
+			packetCount = 0;
+		};
 
-					//Current pixel
-					Vector2 pixel{ (float)px,(float)py };
+	for (size_t triangleIndex{}; triangleIndex < visibleTriangleCount; ++triangleIndex)
+	{
+		const VisibleTriangle& triangle{ pVisibleTriangles[triangleIndex] };
+		const VertexBatch& batch{ m_VertexBatches[triangle.batchIndex] };
+		const Mesh& mesh{ *batch.pMesh };
+		const Material& material{ m_Materials[batch.pInstance->materialIndex] };
 
+		//A packet only holds pixels of one material
+		if (&material != pShaderMaterial)
+		{
+			shadePacket();
+			shaderState = GetPixelShaderState(material);
+			pShaderMaterial = &material;
+		}
 
-					//Check if the current pixel overlaps the triangle formed by the vertices
-					//2D cross product gives a float, based on sign we know if the point is inside the triangle
-					Vector2 edge0{ {v1.x - v0.x}, {v1.y - v0.y} };
-					Vector2 pointToEdge0{ Vector2{v0.x, v0.y }, pixel };
-					float cross0{ Vector2::Cross(edge0, pointToEdge0) };
+		const uint32_t index0{ triangle.indices[0] };
+		const uint32_t index1{ triangle.indices[1] };
+		const uint32_t index2{ triangle.indices[2] };
 
-					Vector2 edge1{ {v2.x - v1.x}, {v2.y - v1.y} };
-					Vector2 pointToEdge1{ Vector2{v1.x, v1.y }, pixel };
-					float cross1{ Vector2::Cross(edge1, pointToEdge1) };
+		Vector4 v0{ GatherPosition(m_VertexStreamsOut, batch.firstVertex + index0) };
+		Vector4 v1{ GatherPosition(m_VertexStreamsOut, batch.firstVertex + index1) };
+		Vector4 v2{ GatherPosition(m_VertexStreamsOut, batch.firstVertex + index2) };
 
-					Vector2 edge2{ {v0.x - v2.x}, {v0.y - v2.y} };
-					Vector2 pointToEdge2{ Vector2{v2.x, v2.y }, pixel };
-					float cross2{ Vector2::Cross(edge2, pointToEdge2) };
+		//Attributes were only transformed for triangles that survived culling
+		const Vertex_Out vertex0{ GatherVertex(mesh.streams, index0, m_VertexStreamsOut, batch.firstVertex + index0, varyings) };
+		const Vertex_Out vertex1{ GatherVertex(mesh.streams, index1, m_VertexStreamsOut, batch.firstVertex + index1, varyings) };
+		const Vertex_Out vertex2{ GatherVertex(mesh.streams, index2, m_VertexStreamsOut, batch.firstVertex + index2, varyings) };
 
-					if (cross0 > 0.0f && cross1 > 0.0f && cross2 > 0.0f)
-					{
-						//Calculate the barycentric coordinates
-						//2D cross product of V1V0 and V2V0
-						float areaOfparallelogram{ Vector2::Cross(edge0, edge1) };
+		//Pre-calculate value for the depth buffer -> depth buffer will not be linear anymore
+		float v0InvDepth{ 1 / v0.w };
+		float v1InvDepth{ 1 / v1.w };
+		float v2InvDepth{ 1 / v2.w };
 
-						//Calculate the weights
-						float w0{ Vector2::Cross(edge1, pointToEdge1) / areaOfparallelogram };
-						float w1{ Vector2::Cross(edge2, pointToEdge2) / areaOfparallelogram };
-						float w2{ Vector2::Cross(edge0, pointToEdge0) / areaOfparallelogram };
+		//Convert from NDC to raster space
+		//Go from [-1,1] range to [0,1] range, taking screen size into acount
+		v0.x = ((v0.x + 1) / 2.0f) * m_Width;
+		v0.y = ((1 - v0.y) / 2.0f) * m_Height;
 
-						if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
-						{
-							//Do the depth buffer test
-							float zBuffer0{ (1.0f / v0.z) * w0 };
-							float zBuffer1{ (1.0f / v1.z) * w1 };
-							float zBuffer2{ (1.0f / v2.z) * w2 };
+		v1.x = ((v1.x + 1) / 2.0f) * m_Width;
+		v1.y = ((1 - v1.y) / 2.0f) * m_Height;
 
-							float zBuffer{ zBuffer0 + zBuffer1 + zBuffer2 };
-							float invZBuffer{ 1.0f / zBuffer };
+		v2.x = ((v2.x + 1) / 2.0f) * m_Width;
+		v2.y = ((1 - v2.y) / 2.0f) * m_Height;
 
-							if (invZBuffer < 0.0f || invZBuffer > 1.0f)
-							{
-								break;
-							}
 
-							if (invZBuffer < m_pDepthBufferPixels[px + (py * m_Width)])
-							{
-								//Write value of invZbuffer to the depthBuffer
-								m_pDepthBufferPixels[px + (py * m_Width)] = invZBuffer;
+		//Calculate the bounding box
+		float xMin = std::min(std::min(v0.x, v1.x), v2.x);
+		float xMax = std::max(std::max(v0.x, v1.x), v2.x);
 
-								//Interpolated the depth value
-								float wInterpolated{ 1.0f / ((w0 / v0.w) + (w1 / v1.w) + (w2 / v2.w)) };
+		float yMin = std::min(std::min(v0.y, v1.y), v2.y);
+		float yMax = std::max(std::max(v0.y, v1.y), v2.y);
+
+		TouchTiles(xMin, yMin, xMax, yMax);
 
-								//Interpolated colour
-								ColorRGB interpolatedColour{ transformedVertices[index0].color * (w0 / v0.w) +
-															transformedVertices[index1].color * (w1 / v1.w) +
-															transformedVertices[index2].color * (w2 / v2.w) };
-								interpolatedColour *= wInterpolated;
+		//Use the min and max values of the bounding box to loop over the pixels
+		for (int py{ (int)yMin }; py < yMax; ++py)
+		{
+			for (int px{ (int)xMin }; px < xMax; ++px)
+			{
+				//Current pixel
+				Vector2 pixel{ (float)px,(float)py };
 
 
-								//Interpolated uv
-								Vector2 interpolatedUV{ transformedVertices[index0].uv * (w0 / v0.w) +
-														transformedVertices[index1].uv * (w1 / v1.w) +
-														transformedVertices[index2].uv * (w2 / v2.w) };
-								interpolatedUV *= wInterpolated;
+				//Check if the current pixel overlaps the triangle formed by the vertices
+				//2D cross product gives a float, based on sign we know if the point is inside the triangle
+				Vector2 edge0{ {v1.x - v0.x}, {v1.y - v0.y} };
+				Vector2 pointToEdge0{ Vector2{v0.x, v0.y }, pixel };
+				float cross0{ Vector2::Cross(edge0, pointToEdge0) };
 
-								/*interpolatedUV.x = Clamp(interpolatedUV.x, 0.f, 1.f);
-								interpolatedUV.y = Clamp(interpolatedUV.y, 0.f, 1.f);*/
+				Vector2 edge1{ {v2.x - v1.x}, {v2.y - v1.y} };
+				Vector2 pointToEdge1{ Vector2{v1.x, v1.y }, pixel };
+				float cross1{ Vector2::Cross(edge1, pointToEdge1) };
 
+				Vector2 edge2{ {v0.x - v2.x}, {v0.y - v2.y} };
+				Vector2 pointToEdge2{ Vector2{v2.x, v2.y }, pixel };
+				float cross2{ Vector2::Cross(edge2, pointToEdge2) };
 
-								//Interpolated normal
-								Vector3 interpolatedNormal{ transformedVertices[index0].normal * (w0 / v0.w) +
-															transformedVertices[index1].normal * (w1 / v1.w) +
-															transformedVertices[index2].normal * (w2 / v2.w) };
-								interpolatedNormal *= wInterpolated;
-								//Normalize direction vectors!
-								interpolatedNormal.Normalize();
+				if (cross0 > 0.0f && cross1 > 0.0f && cross2 > 0.0f)
+				{
+					//Calculate the barycentric coordinates
+					//2D cross product of V1V0 and V2V0
+					float areaOfparallelogram{ Vector2::Cross(edge0, edge1) };
 
+					//Calculate the weights
+					float w0{ Vector2::Cross(edge1, pointToEdge1) / areaOfparallelogram };
+					float w1{ Vector2::Cross(edge2, pointToEdge2) / areaOfparallelogram };
+					float w2{ Vector2::Cross(edge0, pointToEdge0) / areaOfparallelogram };
+
+					if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+					{
+						//Do the depth buffer test
+						float depth{};
+						if (m_DepthFormat == DepthFormat::Float32Reversed)
+						{
+							//NDC depth is affine in screen space, the plain blend keeps the precision the reversed range buys
+							depth = w0 * v0.z + w1 * v1.z + w2 * v2.z;
+						}
+						else
+						{
+							float zBuffer0{ (1.0f / v0.z) * w0 };
+							float zBuffer1{ (1.0f / v1.z) * w1 };
+							float zBuffer2{ (1.0f / v2.z) * w2 };
+
+							float zBuffer{ zBuffer0 + zBuffer1 + zBuffer2 };
+							depth = 1.0f / zBuffer;
+						}
 
-								//Interpolated tangent
-								Vector3 interpolatedTangent{ transformedVertices[index0].tangent * (w0 / v0.w) +
-															transformedVertices[index1].tangent * (w1 / v1.w) +
-															transformedVertices[index2].tangent * (w2 / v2.w) };
-								interpolatedTangent *= wInterpolated;
-								//Normalize direction vectors!
-								interpolatedTangent.Normalize();
+						if (depth < 0.0f || depth > 1.0f)
+						{
+							break;
+						}
 
+						//Compares and writes in the current depth format
+						const size_t pixelIndex{ GetTiledIndex(px, py) };
+						if (DepthTest(pixelIndex, depth))
+						{
 
-								//Interpolated viewDirection
-								Vector3 interpolatedViewDirection{ transformedVertices[index0].viewDirection * (w0 / v0.w) +
-																	transformedVertices[index1].viewDirection * (w1 / v1.w) +
-																	transformedVertices[index2].viewDirection * (w2 / v2.w) };
-								interpolatedViewDirection *= wInterpolated;
-								//Normalize direction vectors!
-								interpolatedViewDirection.Normalize();
+							//Interpolated the depth value
+							float wInterpolated{ 1.0f / ((w0 / v0.w) + (w1 / v1.w) + (w2 / v2.w)) };
 
+							//Perspective correct weights of the three vertices
+							const float weight0{ (w0 / v0.w) * wInterpolated };
+							const float weight1{ (w1 / v1.w) * wInterpolated };
+							const float weight2{ (w2 / v2.w) * wInterpolated };
 
-								Vertex_Out pixelInfo{};
-								pixelInfo.position = Vector4{ pixel.x, pixel.y, invZBuffer, wInterpolated };
-								pixelInfo.uv = interpolatedUV;
-								pixelInfo.normal = interpolatedNormal;
-								pixelInfo.tangent = interpolatedTangent;
-								pixelInfo.viewDirection = interpolatedViewDirection;
+							//Only interpolate what the pixel shader of the current shading mode reads
+							const int lane{ packetCount };
+							if (varyings & Varyings::UV)
+							{
+								packet.u[lane] = vertex0.uv.x * weight0 + vertex1.uv.x * weight1 + vertex2.uv.x * weight2;
+								packet.v[lane] = vertex0.uv.y * weight0 + vertex1.uv.y * weight1 + vertex2.uv.y * weight2;
+							}
 
-								//Render the pixel
-								finalColor = RenderPixelInfo(pixelInfo);
+							//Normalize direction vectors!
+							if (varyings & Varyings::Normal)
+							{
+								Vector3 interpolatedNormal{ vertex0.normal * weight0 + vertex1.normal * weight1 + vertex2.normal * weight2 };
+								normalize(interpolatedNormal);
+								packet.normalX[lane] = interpolatedNormal.x;
+								packet.normalY[lane] = interpolatedNormal.y;
+								packet.normalZ[lane] = interpolatedNormal.z;
+							}
 
-								//Update Color in Buffer
-								finalColor.MaxToOne();
+							if (varyings & Varyings::Tangent)
+							{
+								Vector3 interpolatedTangent{ vertex0.tangent * weight0 + vertex1.tangent * weight1 + vertex2.tangent * weight2 };
+								normalize(interpolatedTangent);
+								packet.tangentX[lane] = interpolatedTangent.x;
+								packet.tangentY[lane] = interpolatedTangent.y;
+								packet.tangentZ[lane] = interpolatedTangent.z;
+							}
 
-								m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-									static_cast<uint8_t>(finalColor.r * 255),
-									static_cast<uint8_t>(finalColor.g * 255),
-									static_cast<uint8_t>(finalColor.b * 255));
+							if (varyings & Varyings::ViewDirection)
+							{
+								Vector3 interpolatedViewDirection{ vertex0.viewDirection * weight0 + vertex1.viewDirection * weight1 + vertex2.viewDirection * weight2 };
+								normalize(interpolatedViewDirection);
+								packet.viewDirectionX[lane] = interpolatedViewDirection.x;
+								packet.viewDirectionY[lane] = interpolatedViewDirection.y;
+								packet.viewDirectionZ[lane] = interpolatedViewDirection.z;
 							}
+
+							packetPixels[lane] = static_cast<uint32_t>(pixelIndex);
+							if (++packetCount == PixelPacket::Size)
+								shadePacket();
 						}
 					}
 				}
 			}
 		}
 	}
+
+	shadePacket();
+
+	//Tiles no triangle covered still need the clear colour, the others are copied (or tonemapped) into the linear back buffer
+	ResolveTiles();
 }
 
 void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_in, std::vector<Vertex>& vertices_out) const
@@ -1755,76 +1943,293 @@ void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_
 	}
 }
 
-void Renderer::VertexTransformationFunction(std::vector<Mesh>& mesh_In) const
+void Renderer::VertexTransformationFunction(const Mesh& mesh, const Matrix& worldMatrix, std::vector<Vertex_Out>& vertices_out, int lod) const
 {
-	Matrix worldViewProjectionMatrix{};
+	const Matrix worldViewProjectionMatrix{ worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix };
+
+	//Coarser LODs only reference a prefix of the vertex buffer
+	//Sized once and written in place, the vector keeps its capacity so a steady frame doesn't allocate
+	const size_t vertexCount{ mesh.lods.empty() ? mesh.vertices.size() : mesh.lods[lod].vertexCount };
+	vertices_out.resize(vertexCount);
+	for (size_t index{}; index < vertexCount; ++index)
+	{
+		const Vertex& vertex{ mesh.vertices[index] };
+
+		//Transfrom vertex from model space to screen space (aka raster space)
+		Vector4 position{ Vector4{vertex.position, 1} };
+		Vector4 transformedVertex{ worldViewProjectionMatrix.TransformPoint(position) };
+
+		//Get the viewDirection from the vertex position
+		Vector3 viewDirection{ worldMatrix.TransformPoint(vertex.position) - m_Camera.origin };
+
+		//Do the perspective divide with the w component from the Vector4 transfromedVertex
+		transformedVertex.x /= transformedVertex.w;
+		transformedVertex.y /= transformedVertex.w;
+		transformedVertex.z /= transformedVertex.w;
+
+		//Normal and tangent info from vertex
+		Vector3 normal = worldMatrix.TransformVector(vertex.normal);
+		normal.Normalize();
+		Vector3 tangent = worldMatrix.TransformVector(vertex.tangent);
+		tangent.Normalize();
+
+		Vertex_Out outVertex{};
+		outVertex.color = vertex.color;
+		outVertex.normal = normal;
+		outVertex.position = transformedVertex;
+		outVertex.tangent = tangent;
+		outVertex.uv = vertex.uv;
+		outVertex.viewDirection = viewDirection;
+
+		vertices_out[index] = outVertex;
+	}
+}
 
+void Renderer::VertexTransformationFunction(std::vector<VertexBatch>& batches, size_t vertexCount, VertexStreamsOut& vertices_out)
+{
+	//Size the output up front, the jobs only write into their own disjoint ranges
+	Utils::AllocateVertexStreams(m_FrameArena, vertices_out, vertexCount);
 
-	for (Mesh& mesh : mesh_In)
+	for (VertexBatch& batch : batches)
 	{
-		worldViewProjectionMatrix *= mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
-		mesh.vertices_out.clear();
+		batch.worldViewProjectionMatrix = batch.pInstance->worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+	}
+
+	//Positions only, the attributes wait until culling decided which vertices are still needed
+	ParallelForVertexRanges(batches, vertexCount, [&](const VertexBatch& batch, size_t begin, size_t end)
+		{
+			Utils::TransformPositionStreams(batch.pMesh->streams, begin - batch.firstVertex, end - begin, batch.worldViewProjectionMatrix, vertices_out, begin);
+		});
+}
+
+void Renderer::VertexAttributeFunction(const std::vector<VertexBatch>& batches, size_t vertexCount, const uint8_t* pBlockMask, uint32_t varyings,
+	VertexStreamsOut& vertices_out)
+{
+	ParallelForVertexRanges(batches, vertexCount, [&](const VertexBatch& batch, size_t begin, size_t end)
+		{
+			Utils::TransformAttributeStreams(batch.pMesh->streams, begin - batch.firstVertex, end - begin, batch.pInstance->worldMatrix, m_Camera.origin,
+				pBlockMask, varyings, vertices_out, begin);
+		});
+}
+
+void Renderer::BeginLazyClear()
+{
+	m_IsTileTouched.assign(m_ClearTileCountX * m_ClearTileCountY, 0);
+}
+
+void Renderer::TouchTiles(float xMin, float yMin, float xMax, float yMax)
+{
+	const int tileXMin{ Clamp(static_cast<int>(xMin) / m_ClearTileSize, 0, m_ClearTileCountX - 1) };
+	const int tileYMin{ Clamp(static_cast<int>(yMin) / m_ClearTileSize, 0, m_ClearTileCountY - 1) };
+	const int tileXMax{ Clamp(static_cast<int>(xMax) / m_ClearTileSize, 0, m_ClearTileCountX - 1) };
+	const int tileYMax{ Clamp(static_cast<int>(yMax) / m_ClearTileSize, 0, m_ClearTileCountY - 1) };
+	std::vector<uint8_t>& tileHasClearColor{ m_TileHasClearColor[m_BackBufferIndex] };
 
-		for (auto& vertex : mesh.vertices)
+	for (int tileY{ tileYMin }; tileY <= tileYMax; ++tileY)
+	{
+		for (int tileX{ tileXMin }; tileX <= tileXMax; ++tileX)
 		{
-			//Transfrom vertex from model space to screen space (aka raster space)
-			Vector4 position{ Vector4{vertex.position, 1} };
-			Vector4 transformedVertex{ worldViewProjectionMatrix.TransformPoint(position) };
-
-			//Get the viewDirection from the vertex position
-			Vector3 viewDirection{ mesh.worldMatrix.TransformPoint(vertex.position) - m_Camera.origin };
-
-			//Do the perspective divide with the w component from the Vector4 transfromedVertex
-			transformedVertex.x /= transformedVertex.w;
-			transformedVertex.y /= transformedVertex.w;
-			transformedVertex.z /= transformedVertex.w;
-
-			//Normal and tangent info from vertex
-			Vector3 normal = mesh.worldMatrix.TransformVector(vertex.normal);
-			normal.Normalize();
-			Vector3 tangent = mesh.worldMatrix.TransformVector(vertex.tangent);
-			tangent.Normalize();
-
-			Vertex_Out outVertex{};
-			outVertex.color = vertex.color;
-			outVertex.normal = normal;
-			outVertex.position = transformedVertex;
-			outVertex.tangent = tangent;
-			outVertex.uv = vertex.uv;
-			outVertex.viewDirection = viewDirection;
-
-			mesh.vertices_out.push_back(outVertex);
+			const int tileIndex{ tileX + tileY * m_ClearTileCountX };
+			if (m_IsTileTouched[tileIndex])
+				continue;
+
+			//Triangles are about to draw here, the resolve overwrites the back buffer pixels of the tile
+			ClearTile(tileX, tileY);
+			m_IsTileTouched[tileIndex] = 1;
+			tileHasClearColor[tileIndex] = 0;
 		}
 	}
 }
 
-ColorRGB Renderer::RenderPixelInfo(const Vertex_Out& vertexOut)
+void Renderer::ClearTile(int tileX, int tileY)
 {
-	ColorRGB finalColour{};
+	const int xBegin{ tileX * m_ClearTileSize };
+	const int xEnd{ std::min(xBegin + m_ClearTileSize, m_TiledWidth) };
+	const int yBegin{ tileY * m_ClearTileSize };
+	const int yEnd{ std::min(yBegin + m_ClearTileSize, m_TiledHeight) };
+	uint32_t* pTargetPixels{ m_IsHdrEnabled ? m_pHdrPixels : m_pColorPixels };
+	const uint32_t clearValue{ m_IsHdrEnabled ? HdrClearValue : m_ClearColor };
+
+	//The memory tiles of one row of memory tiles inside the clear tile are contiguous
+	const size_t count{ static_cast<size_t>(xEnd - xBegin) * m_MemoryTileSize };
+	for (int py{ yBegin }; py < yEnd; py += m_MemoryTileSize)
+	{
+		const size_t first{ GetTiledIndex(xBegin, py) };
+		ClearDepth(first, count);
+		std::fill_n(pTargetPixels + first, count, clearValue);
+	}
+}
+
+void Renderer::ClearDepth(size_t first, size_t count)
+{
+	switch (m_DepthFormat)
+	{
+	case DepthFormat::Float32Reversed:
+		std::fill_n(m_pDepthBufferPixels + first, count, 0.f);
+		break;
+	case DepthFormat::Unorm24:
+		std::fill_n(m_CompactDepthBuffer.data() + first * 3, count * 3, uint8_t{ 0xff });
+		break;
+	case DepthFormat::Unorm16:
+		std::fill_n(m_CompactDepthBuffer.data() + first * 2, count * 2, uint8_t{ 0xff });
+		break;
+	case DepthFormat::Float32:
+	default:
+		std::fill_n(m_pDepthBufferPixels + first, count, FLT_MAX);
+		break;
+	}
+}
+
+bool Renderer::DepthTest(size_t pixelIndex, float depth)
+{
+	switch (m_DepthFormat)
+	{
+	case DepthFormat::Float32Reversed:
+	{
+		if (!(depth > m_pDepthBufferPixels[pixelIndex]))
+			return false;
+		m_pDepthBufferPixels[pixelIndex] = depth;
+		return true;
+	}
+	case DepthFormat::Unorm24:
+	{
+		//Little endian 3 byte values, depth in [0, 1] is exact enough in float for 24 bit
+		uint8_t* pStored{ m_CompactDepthBuffer.data() + pixelIndex * 3 };
+		const uint32_t stored{ pStored[0] | static_cast<uint32_t>(pStored[1]) << 8 | static_cast<uint32_t>(pStored[2]) << 16 };
+		const uint32_t quantized{ static_cast<uint32_t>(depth * 16777215.f + 0.5f) };
+		if (quantized >= stored)
+			return false;
+		pStored[0] = static_cast<uint8_t>(quantized);
+		pStored[1] = static_cast<uint8_t>(quantized >> 8);
+		pStored[2] = static_cast<uint8_t>(quantized >> 16);
+		return true;
+	}
+	case DepthFormat::Unorm16:
+	{
+		uint8_t* pStored{ m_CompactDepthBuffer.data() + pixelIndex * 2 };
+		uint16_t stored{};
+		std::memcpy(&stored, pStored, sizeof(stored));
+		const uint16_t quantized{ static_cast<uint16_t>(depth * 65535.f + 0.5f) };
+		if (quantized >= stored)
+			return false;
+		std::memcpy(pStored, &quantized, sizeof(quantized));
+		return true;
+	}
+	case DepthFormat::Float32:
+	default:
+	{
+		if (!(depth < m_pDepthBufferPixels[pixelIndex]))
+			return false;
+		m_pDepthBufferPixels[pixelIndex] = depth;
+		return true;
+	}
+	}
+}
 
-	Vector3 lightDirection{ 0.577f,-0.577f,0.577f };
-	float lightIntensity{ 7.0f };
-	ColorRGB totalLight{ ColorRGB{1.0f,1.0f,1.0f} * lightIntensity };
-	float shininess{ 25.0f };
-	ColorRGB ambient{ 0.025f,0.025f,0.025f };
+void Renderer::ResolveTiles()
+{
+	std::vector<uint8_t>& tileHasClearColor{ m_TileHasClearColor[m_BackBufferIndex] };
 
-	//Diffuse map
-	ColorRGB diffuse = m_pVehicleDiffuse->Sample(vertexOut.uv);
+	//One job per row of tiles, tiles don't share pixels
+	m_pJobSystem->ParallelFor(static_cast<uint32_t>(m_ClearTileCountY), [&](uint32_t tileY)
+		{
+			for (int tileX{}; tileX < m_ClearTileCountX; ++tileX)
+			{
+				const int tileIndex{ tileX + static_cast<int>(tileY) * m_ClearTileCountX };
+				const bool isTouched{ m_IsTileTouched[tileIndex] != 0 };
+				if (!isTouched && tileHasClearColor[tileIndex] != 0)
+					continue;
 
-	//Normal map
-	Vector3 biNormal{ Vector3::Cross(vertexOut.normal, vertexOut.tangent).Normalized() };
-	Matrix tangentAxisSpace{ Matrix{vertexOut.tangent, biNormal, vertexOut.normal, {0,0,0}} };
+				const int xBegin{ tileX * m_ClearTileSize };
+				const int xEnd{ std::min(xBegin + m_ClearTileSize, m_Width) };
+				const int yBegin{ static_cast<int>(tileY) * m_ClearTileSize };
+				const int yEnd{ std::min(yBegin + m_ClearTileSize, m_Height) };
+				if (!isTouched)
+				{
+					//Only the colour, the depth of an untouched tile is never read
+					for (int py{ yBegin }; py < yEnd; ++py)
+					{
+						std::fill_n(m_pBackBufferPixels + xBegin + py * m_Width, xEnd - xBegin, m_ClearColor);
+					}
+					tileHasClearColor[tileIndex] = 1;
+					continue;
+				}
+
+				//Memory tile by memory tile, HDR pixels are tonemapped as one contiguous run before their rows are spread out
+				uint32_t resolvedPixels[m_MemoryTileSize * m_MemoryTileSize];
+				for (int py{ yBegin }; py < yEnd; py += m_MemoryTileSize)
+				{
+					const int rowCount{ std::min(m_MemoryTileSize, yEnd - py) };
+					for (int px{ xBegin }; px < xEnd; px += m_MemoryTileSize)
+					{
+						const size_t first{ GetTiledIndex(px, py) };
+						const uint32_t* pTilePixels{ m_pColorPixels + first };
+						if (m_IsHdrEnabled)
+						{
+							Utils::ResolveHdr(m_HdrResolveState, m_pHdrPixels + first, resolvedPixels, m_MemoryTileSize * m_MemoryTileSize);
+							pTilePixels = resolvedPixels;
+						}
+
+						const int columnCount{ std::min(m_MemoryTileSize, xEnd - px) };
+						for (int row{}; row < rowCount; ++row)
+						{
+							std::copy_n(pTilePixels + row * m_MemoryTileSize, columnCount, m_pBackBufferPixels + px + (py + row) * m_Width);
+						}
+					}
+				}
+			}
+		});
+}
+
+void Renderer::ParallelForVertexRanges(const std::vector<VertexBatch>& batches, size_t vertexCount, FunctionRef<void(const VertexBatch&, size_t, size_t)> function)
+{
+	//Fixed size jobs over the combined output: small instances share a job, large ones get split
+	const uint32_t jobCount{ static_cast<uint32_t>((vertexCount + m_VertexJobSize - 1) / m_VertexJobSize) };
+	m_pJobSystem->ParallelFor(jobCount, [&](uint32_t job)
+		{
+			const size_t jobBegin{ job * m_VertexJobSize };
+			const size_t jobEnd{ std::min(jobBegin + m_VertexJobSize, vertexCount) };
+
+			//First batch that still has vertices after the start of this job
+			auto batchIt = std::upper_bound(batches.begin(), batches.end(), jobBegin, [](size_t vertex, const VertexBatch& batch)
+				{
+					return vertex < batch.firstVertex + simd::PaddedCount(batch.vertexCount);
+				});
 
-	ColorRGB normalColour{ m_pVehicleNormal->Sample(vertexOut.uv) };
-	Vector3 normal{ 2.0f * normalColour.r - 1.0f, 2.0f * normalColour.g - 1.0f, 2.0f * normalColour.b - 1.0f };
-	normal = tangentAxisSpace.TransformVector(normal);
-	normal.Normalize();
+			for (; batchIt != batches.end() && batchIt->firstVertex < jobEnd; ++batchIt)
+			{
+				const size_t begin{ std::max(jobBegin, batchIt->firstVertex) };
+				const size_t end{ std::min(jobEnd, batchIt->firstVertex + batchIt->vertexCount) };
+				if (begin >= end)
+					continue;
+
+				function(*batchIt, begin, end);
+			}
+		});
+}
 
-	//Glossy map
-	ColorRGB gloss = m_pVehicleGlossy->Sample(vertexOut.uv);
+ColorRGB Renderer::RenderPixelInfo(const Vertex_Out& vertexOut, const Material& material)
+{
+	ColorRGB finalColour{};
 
-	//Specular map
-	ColorRGB specular = m_pVehicleSpecular->Sample(vertexOut.uv);
+	constexpr Vector3 lightDirection{ 0.577f,-0.577f,0.577f };
+	constexpr float lightIntensity{ 7.0f };
+	constexpr ColorRGB totalLight{ ColorRGB{1.0f,1.0f,1.0f} * lightIntensity };
+	constexpr float shininess{ 25.0f };
+	constexpr ColorRGB ambient{ 0.025f,0.025f,0.025f };
+
+	//Normal map
+	Vector3 normal{ vertexOut.normal };
+	if (m_IsNormalMapEnabled)
+	{
+		Vector3 biNormal{ Vector3::Cross(vertexOut.normal, vertexOut.tangent).Normalized() };
+		Matrix tangentAxisSpace{ Matrix{vertexOut.tangent, biNormal, vertexOut.normal, {0,0,0}} };
+
+		ColorRGB normalColour{ material.pNormal->Sample(vertexOut.uv) };
+		normal = { 2.0f * normalColour.r - 1.0f, 2.0f * normalColour.g - 1.0f, 2.0f * normalColour.b - 1.0f };
+		normal = tangentAxisSpace.TransformVector(normal);
+		normal.Normalize();
+	}
 
 	//Calculate labert cosine
 	//Make sure that the normal and the lightDirection point in the same direction (originally opposed to each other)
@@ -1837,9 +2242,13 @@ ColorRGB Renderer::RenderPixelInfo(const Vertex_Out& vertexOut)
 
 	switch (m_Shadingmode)
 	{
-	case dae::Renderer::ShadingMode::Combined:
+	case ShadingMode::Combined:
 
 	{
+		ColorRGB diffuse = material.pDiffuse->Sample(vertexOut.uv);
+		ColorRGB gloss = material.pGloss->Sample(vertexOut.uv);
+		ColorRGB specular = material.pSpecular->Sample(vertexOut.uv);
+
 		ColorRGB phongExponent{ gloss * shininess };
 
 		Vector3 reflect{ Vector3::Reflect(-lightDirection, normal)};
@@ -1853,18 +2262,23 @@ ColorRGB Renderer::RenderPixelInfo(const Vertex_Out& vertexOut)
 	}
 
 	break;
-	case dae::Renderer::ShadingMode::Diffuse:
+	case ShadingMode::Diffuse:
 
 	{
+		ColorRGB diffuse = material.pDiffuse->Sample(vertexOut.uv);
+
 		ColorRGB rho{ diffuse };
 		ColorRGB diffuseColour{ rho / PI };
 		finalColour = totalLight * diffuseColour * lambertCosine;
 	}
 
 	break;
-	case dae::Renderer::ShadingMode::Specular:
+	case ShadingMode::Specular:
 
 	{
+		ColorRGB gloss = material.pGloss->Sample(vertexOut.uv);
+		ColorRGB specular = material.pSpecular->Sample(vertexOut.uv);
+
 		ColorRGB phongExponent{ gloss * shininess };
 
 		Vector3 reflect{ Vector3::Reflect(-lightDirection, normal) };
@@ -1875,7 +2289,7 @@ ColorRGB Renderer::RenderPixelInfo(const Vertex_Out& vertexOut)
 	}
 
 	break;
-	case dae::Renderer::ShadingMode::ObservedArea:
+	case ShadingMode::ObservedArea:
 
 	{
 		finalColour = { lambertCosine,lambertCosine,lambertCosine };
@@ -1899,13 +2313,80 @@ float Renderer::GetTriangleEdge(const Vector3& a, const Vector3& b, const Vector
 	return (c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x);
 }
 
-bool Renderer::SaveBufferToImage() const
+void Renderer::SaveBufferToImage() const
+{
+	//The present thread only reads the last target as well, so it can be copied while it is on its way to the screen
+	m_pScreenshotWriter->Save(m_pBackBufferPixels, m_Width, m_Height, m_BackBufferFormat, m_ScreenshotFormat,
+		std::string{ "Rasterizer_ColorBuffer" } + Utils::GetImageExtension(m_ScreenshotFormat));
+}
+
+bool Renderer::StartFrameSequence(FrameSequenceFormat format, const std::string& path)
 {
-	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
+	StopFrameSequence();
+
+	m_pSequenceWriter = new FrameSequenceWriter(format, path, m_Width, m_Height, m_BackBufferFormat);
+	if (m_pSequenceWriter->IsGood())
+		return true;
+
+	StopFrameSequence();
+	return false;
+}
+
+uint32_t Renderer::StopFrameSequence()
+{
+	if (!m_pSequenceWriter)
+		return 0;
+
+	m_pSequenceWriter->WaitUntilWritten();
+	const uint32_t frameCount{ m_pSequenceWriter->GetWrittenFrameCount() };
+
+	delete m_pSequenceWriter;
+	m_pSequenceWriter = nullptr;
+	return frameCount;
 }
 
 void Renderer::ToggleRotation()
 {
+	m_IsRotating = !m_IsRotating;
+}
+
+PixelShaderState Renderer::GetPixelShaderState(const Material& material) const
+{
+	PixelShaderState state{};
+	state.shadingMode = m_Shadingmode;
+	state.specularPrecision = m_SpecularPrecision;
+	state.isNormalMapEnabled = m_IsNormalMapEnabled;
+	state.isHdrOutput = m_IsHdrEnabled;
+	state.outputFormat = m_BackBufferFormat;
+	state.diffuse = material.pDiffuse->GetView();
+	state.normal = material.pNormal->GetView();
+	state.gloss = material.pGloss->GetView();
+	state.specular = material.pSpecular->GetView();
+	return state;
+}
+
+uint32_t Renderer::GetPixelShaderVaryings() const
+{
+	//Every mode lights with the normal, sampling the normal map also needs the uv and the tangent frame
+	uint32_t varyings{ Varyings::Normal };
+	if (m_IsNormalMapEnabled)
+		varyings |= Varyings::UV | Varyings::Tangent;
+
+	switch (m_Shadingmode)
+	{
+	case ShadingMode::Combined:
+	case ShadingMode::Specular:
+		varyings |= Varyings::UV | Varyings::ViewDirection;
+		break;
+	case ShadingMode::Diffuse:
+		varyings |= Varyings::UV;
+		break;
+	case ShadingMode::ObservedArea:
+	default:
+		break;
+	}
+
+	return varyings;
 }
 
 void Renderer::ToggleNormalMap()
@@ -1917,16 +2398,16 @@ void Renderer::SwitchShadingMode()
 {
 	switch (m_Shadingmode)
 	{
-	case Renderer::ShadingMode::Combined:
+	case ShadingMode::Combined:
 		m_Shadingmode = ShadingMode::ObservedArea;
 		break;
-	case Renderer::ShadingMode::ObservedArea:
+	case ShadingMode::ObservedArea:
 		m_Shadingmode = ShadingMode::Diffuse;
 		break;
-	case Renderer::ShadingMode::Diffuse:
+	case ShadingMode::Diffuse:
 		m_Shadingmode = ShadingMode::Specular;
 		break;
-	case Renderer::ShadingMode::Specular:
+	case ShadingMode::Specular:
 		m_Shadingmode = ShadingMode::Combined;
 		break;
 	default:
@@ -1934,6 +2415,80 @@ void Renderer::SwitchShadingMode()
 	}
 }
 
+void Renderer::SwitchSpecularPrecision()
+{
+	switch (m_SpecularPrecision)
+	{
+	case SpecularPrecision::Polynomial:
+		m_SpecularPrecision = SpecularPrecision::FastPolynomial;
+		break;
+	case SpecularPrecision::FastPolynomial:
+		m_SpecularPrecision = SpecularPrecision::Reference;
+		break;
+	case SpecularPrecision::Reference:
+	default:
+		m_SpecularPrecision = SpecularPrecision::Polynomial;
+		break;
+	}
+
+	//Validate the approximation against std::pow over the whole range the shader can hit
+	Utils::GetLogStream() << "Specular: " << Utils::GetSpecularPrecisionName(m_SpecularPrecision)
+		<< ", max error " << Utils::MeasureSpecularError(m_SpecularPrecision) << std::endl;
+}
+
+void Renderer::SwitchDepthFormat()
+{
+	switch (m_DepthFormat)
+	{
+	case DepthFormat::Float32:
+		m_DepthFormat = DepthFormat::Float32Reversed;
+		break;
+	case DepthFormat::Float32Reversed:
+		m_DepthFormat = DepthFormat::Unorm24;
+		break;
+	case DepthFormat::Unorm24:
+		m_DepthFormat = DepthFormat::Unorm16;
+		break;
+	case DepthFormat::Unorm16:
+	default:
+		m_DepthFormat = DepthFormat::Float32;
+		break;
+	}
+
+	//The projection has to produce the depth range the comparison expects
+	m_Camera.isDepthReversed = m_DepthFormat == DepthFormat::Float32Reversed;
+	m_Camera.CalculateProjectionMatrix();
+
+	const char* pName{ "Float32" };
+	switch (m_DepthFormat)
+	{
+	case DepthFormat::Float32Reversed:
+		pName = "Float32 reversed-Z";
+		break;
+	case DepthFormat::Unorm24:
+		pName = "Unorm24";
+		break;
+	case DepthFormat::Unorm16:
+		pName = "Unorm16";
+		break;
+	default:
+		break;
+	}
+	Utils::GetLogStream() << "Depth format: " << pName << std::endl;
+}
+
+void Renderer::ToggleHdr()
+{
+	m_IsHdrEnabled = !m_IsHdrEnabled;
+	Utils::GetLogStream() << "HDR: " << (m_IsHdrEnabled ? "on" : "off") << std::endl;
+}
+
+void Renderer::SwitchToneMapper()
+{
+	m_HdrResolveState.toneMapper = m_HdrResolveState.toneMapper == ToneMapper::ACES ? ToneMapper::Reinhard : ToneMapper::ACES;
+	Utils::GetLogStream() << "Tone mapper: " << Utils::GetToneMapperName(m_HdrResolveState.toneMapper) << std::endl;
+}
+
 bool Renderer::IsPointInTriangle(const std::vector<Vector3>& screenTriangleCoordinates, int pixelX, int pixelY)
 {
 	const Vector3 p{ (float)pixelX, (float)pixelY, 0.f };
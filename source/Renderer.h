@@ -5,6 +5,14 @@
 
 #include "Camera.h"
 #include "DataTypes.h"
+#include "FrameArena.h"
+#include "FramePresenter.h"
+#include "FrameSequenceWriter.h"
+#include "FunctionRef.h"
+#include "JobSystem.h"
+#include "PixelShading.h"
+#include "SceneBVH.h"
+#include "ScreenshotWriter.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -20,7 +28,8 @@ namespace dae
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
+		//Every parallel stage runs on pJobSystem, which has to outlive the renderer
+		Renderer(SDL_Window* pWindow, JobSystem* pJobSystem);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -31,28 +40,82 @@ namespace dae
 		void Update(Timer* pTimer);
 		void Render();
 
-		bool SaveBufferToImage() const;
+		//Snapshot of the last frame, encoded and written on the screenshot thread which reports the result
+		void SaveBufferToImage() const;
+		void SetScreenshotFormat(ImageFormat format) { m_ScreenshotFormat = format; }
+		//Opt-in: the interpolated normal, tangent and view direction use Vector3::NormalizeFast instead of the precise Normalize
+		void SetFastNormalize(bool isEnabled) { m_IsFastNormalizeEnabled = isEnabled; }
+
+		//Hands every rendered frame to a background writer until stopped, returns false if the output can't be opened
+		bool StartFrameSequence(FrameSequenceFormat format, const std::string& path);
+		//Waits until the queued frames are written, returns how many frames the sequence has
+		uint32_t StopFrameSequence();
 
 		void ToggleRotation();
 		void ToggleNormalMap();
 		void SwitchShadingMode();
+		void SwitchSpecularPrecision();
+		//Shades into the linear HDR target and tonemaps it at the end of the frame
+		void ToggleHdr();
+		void SwitchToneMapper();
+		//Cycles Float32 -> reversed-Z Float32 -> Unorm24 -> Unorm16, the camera projection follows
+		void SwitchDepthFormat();
 
 	private:
-		enum class ShadingMode
+		//Vertex work of one visible instance, written at firstVertex in the shared output
+		struct VertexBatch
+		{
+			const Mesh* pMesh{};
+			const MeshInstance* pInstance{};
+			int lod{};
+			size_t firstVertex{};
+			size_t vertexCount{};
+			Matrix worldViewProjectionMatrix{};
+		};
+
+		//Triangle that survived culling, indices are local to the mesh of its batch
+		struct VisibleTriangle
 		{
-			Combined,
-			ObservedArea,
-			Diffuse,
-			Specular
+			uint32_t batchIndex{};
+			uint32_t indices[3]{};
 		};
 
 		SDL_Window* m_pWindow{};
 
-		SDL_Surface* m_pFrontBuffer{ nullptr };
+		//Render targets and the thread that presents them, m_pBackBuffer is the target of the current (or last) frame
+		FramePresenter* m_pPresenter{ nullptr };
+		uint32_t m_BackBufferIndex{};
 		SDL_Surface* m_pBackBuffer{ nullptr };
+		FrameSequenceWriter* m_pSequenceWriter{ nullptr };
+		ScreenshotWriter* m_pScreenshotWriter{ nullptr };
+		ImageFormat m_ScreenshotFormat{ ImageFormat::PNG };
 		uint32_t* m_pBackBufferPixels{};
-
+		//Channel layout of the back buffer, the packet shader writes finished pixels in it
+		ColorFormat m_BackBufferFormat{};
+
+		//Depth, colour and HDR targets of the vehicle path are tile-major: every 8x8 pixel tile is contiguous and the tiles follow each other row by row,
+		//so a triangle touches a few cache lines instead of one per row. Their size is padded to whole tiles, ResolveTiles makes the back buffer linear
+		static constexpr int m_MemoryTileShift{ 3 };
+		static constexpr int m_MemoryTileSize{ 1 << m_MemoryTileShift };
+		int m_TiledWidth{};
+		int m_TiledHeight{};
+		uint32_t* m_pColorPixels{};
+
+		//Float32 and reversed-Z depth, the unorm formats live in m_CompactDepthBuffer
 		float* m_pDepthBufferPixels{};
+		std::vector<uint8_t> m_CompactDepthBuffer{};
+		DepthFormat m_DepthFormat{ DepthFormat::Float32 };
+
+		//Lazy clears: a tile only gets its depth and colour reset when the first triangle of the frame covers it,
+		//untouched tiles get the clear colour in the back buffer at the end of the frame, unless it still shows it
+		static constexpr int m_ClearTileSize{ 32 };
+		static_assert(m_ClearTileSize % m_MemoryTileSize == 0, "A clear tile has to cover whole memory tiles");
+		int m_ClearTileCountX{};
+		int m_ClearTileCountY{};
+		uint32_t m_ClearColor{};
+		std::vector<uint8_t> m_IsTileTouched;
+		//Per render target and kept across frames, set while every pixel of the tile holds m_ClearColor
+		std::vector<std::vector<uint8_t>> m_TileHasClearColor;
 
 		Camera m_Camera{};
 
@@ -60,6 +123,24 @@ namespace dae
 		int m_Height{};
 
 		std::vector<Mesh> m_Meshes;
+		std::vector<Material> m_Materials;
+		std::vector<MeshInstance> m_Instances;
+
+		SceneBVH m_SceneBVH{};
+		std::vector<uint32_t> m_VisibleInstances;
+
+		//Transient data of the frame being rendered (vertex streams, visible triangles, ...), reset when a frame starts
+		//The parallel stages only write into disjoint ranges of what the render thread allocated, so one arena is enough
+		FrameArena m_FrameArena{ size_t{ 4 } << 20 };
+
+		//Scratch output of the vertex stage, reused by every instance
+		std::vector<Vertex_Out> m_VerticesOut;
+		VertexStreamsOut m_VertexStreamsOut;
+		std::vector<VertexBatch> m_VertexBatches;
+
+		//Vertices per vertex stage job, a multiple of every SIMD width
+		static constexpr size_t m_VertexJobSize{ 4096 };
+		JobSystem* m_pJobSystem{ nullptr };
 
 		std::vector<Vertex> m_Vertices;
 		std::vector<uint32_t> m_Indices;
@@ -74,8 +155,19 @@ namespace dae
 		Matrix m_RotationMatrix;
 
 		ShadingMode m_Shadingmode;
+		SpecularPrecision m_SpecularPrecision{ SpecularPrecision::Polynomial };
+
+		//Linear R11G11B10 float target, tile-major like the colour target and only used while HDR is enabled, the resolve writes the back buffer from it
+		bool m_IsHdrEnabled{ false };
+		uint32_t* m_pHdrPixels{};
+		HdrResolveState m_HdrResolveState{};
 
 		bool m_IsNormalMapEnabled;
+		bool m_IsRotating{ false };
+		bool m_IsFastNormalizeEnabled{ false };
+
+		//Largest simplification error (in pixels) a selected LOD may show
+		float m_LODPixelError{ 1.f };
 
 		void Render_W1_Gradient();
 		void Render_W1_Part1();
@@ -93,11 +185,39 @@ namespace dae
 		void Render_W3_Tuktuk();
 		void Render_W3_Vehicle();
 
-		ColorRGB RenderPixelInfo(const Vertex_Out& vertexOut);
+		ColorRGB RenderPixelInfo(const Vertex_Out& vertexOut, const Material& material);
+		//Varyings mask of the attributes RenderPixelInfo reads in the current shading mode
+		uint32_t GetPixelShaderVaryings() const;
+		//Inputs of the packet shader for the current shading mode, RenderPixelInfo for 8 pixels at once
+		PixelShaderState GetPixelShaderState(const Material& material) const;
 
 		//Function that transforms the vertices from the mesh from World space to Screen space
 		void VertexTransformationFunction(const std::vector<Vertex>& vertices_in, std::vector<Vertex>& vertices_out) const; //W1 Version
-		void VertexTransformationFunction(std::vector<Mesh>& mesh_In) const; //W2 Version
+		void VertexTransformationFunction(const Mesh& mesh, const Matrix& worldMatrix, std::vector<Vertex_Out>& vertices_out, int lod = 0) const; //W2 Version
+		void VertexTransformationFunction(std::vector<VertexBatch>& batches, size_t vertexCount, VertexStreamsOut& vertices_out); //SoA SIMD multi-threaded Version, positions only
+		void VertexAttributeFunction(const std::vector<VertexBatch>& batches, size_t vertexCount, const uint8_t* pBlockMask, uint32_t varyings,
+			VertexStreamsOut& vertices_out);
+		void BeginLazyClear();
+		//Clears every tile the screen space box [min, max] overlaps that wasn't touched yet this frame
+		void TouchTiles(float xMin, float yMin, float xMax, float yMax);
+		void ClearTile(int tileX, int tileY);
+		void ClearDepth(size_t first, size_t count);
+		//Writes depth and returns true if it is closer than the stored value, in the current depth format
+		bool DepthTest(size_t pixelIndex, float depth);
+		//Untouched tiles get the clear colour, touched ones are linearized from the colour target, or tonemapped from the HDR target while it is enabled
+		void ResolveTiles();
+		//Index of a pixel in the tile-major targets
+		size_t GetTiledIndex(int px, int py) const
+		{
+			const uint32_t x{ static_cast<uint32_t>(px) };
+			const uint32_t y{ static_cast<uint32_t>(py) };
+			const size_t tileIndex{ (y >> m_MemoryTileShift) * static_cast<size_t>(m_TiledWidth >> m_MemoryTileShift) + (x >> m_MemoryTileShift) };
+			const uint32_t mask{ m_MemoryTileSize - 1 };
+			return (tileIndex << (2 * m_MemoryTileShift)) | ((y & mask) << m_MemoryTileShift) | (x & mask);
+		}
+
+		//Splits the combined vertex output in fixed size jobs and calls function(batch, begin, end) for every part of a batch in a job
+		void ParallelForVertexRanges(const std::vector<VertexBatch>& batches, size_t vertexCount, FunctionRef<void(const VertexBatch&, size_t, size_t)> function);
 
 		bool IsPointInTriangle(const std::vector<Vertex>& screenTriangleCoordinates, int pixelX, int pixelY);
 		bool IsPointInTriangle(const std::vector<Vertex>& screenTriangleCoordinates, Vector2 point);
@@ -0,0 +1,153 @@
+#include "SIMD.h"
+
+#include <atomic>
+#include <cctype>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		struct CpuIdRegisters
+		{
+			uint32_t eax{};
+			uint32_t ebx{};
+			uint32_t ecx{};
+			uint32_t edx{};
+		};
+
+		CpuIdRegisters CpuId(uint32_t leaf, uint32_t subleaf)
+		{
+			CpuIdRegisters registers{};
+#if defined(_MSC_VER)
+			int values[4]{};
+			__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+			registers = { static_cast<uint32_t>(values[0]), static_cast<uint32_t>(values[1]), static_cast<uint32_t>(values[2]), static_cast<uint32_t>(values[3]) };
+#else
+			__cpuid_count(leaf, subleaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+			return registers;
+		}
+
+		//Register state the OS saves on a context switch, without it the wide registers can't be used even if the CPU has them
+		uint64_t GetEnabledXSaveFeatures()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32_t low{};
+			uint32_t high{};
+			__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+		}
+
+		simd::Isa DetectIsa()
+		{
+			const uint32_t maxLeaf{ CpuId(0, 0).eax };
+			const CpuIdRegisters features{ CpuId(1, 0) };
+
+			const bool hasSSE41{ (features.ecx & (1u << 19)) != 0 };
+			if (!hasSSE41)
+				return simd::Isa::SSE2;
+
+			const bool hasOSXSave{ (features.ecx & (1u << 27)) != 0 };
+			if (!hasOSXSave || maxLeaf < 7)
+				return simd::Isa::SSE41;
+
+			//XMM + YMM state, then opmask + both halves of the upper ZMM state
+			const uint64_t xsaveFeatures{ GetEnabledXSaveFeatures() };
+			const bool osSavesYmm{ (xsaveFeatures & 0x6) == 0x6 };
+			const bool osSavesZmm{ (xsaveFeatures & 0xe6) == 0xe6 };
+
+			//The variants are built with /arch:AVX2 and /arch:AVX512, which let the compiler use more than the name says
+			//AVX2: FMA (leaf 1 ECX bit 12), BMI1 and BMI2 (leaf 7 EBX bits 3 and 8) next to AVX2 itself (bit 5)
+			//AVX512: F, DQ, CD, BW and VL (leaf 7 EBX bits 16, 17, 28, 30 and 31) on top of AVX2
+			const CpuIdRegisters extendedFeatures{ CpuId(7, 0) };
+			constexpr uint32_t avx2Bits{ (1u << 3) | (1u << 5) | (1u << 8) };
+			constexpr uint32_t avx512Bits{ (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31) };
+			const bool hasFMA{ (features.ecx & (1u << 12)) != 0 };
+			const bool hasAVX2{ hasFMA && (extendedFeatures.ebx & avx2Bits) == avx2Bits };
+			const bool hasAVX512{ hasAVX2 && (extendedFeatures.ebx & avx512Bits) == avx512Bits };
+
+			if (hasAVX512 && osSavesZmm)
+				return simd::Isa::AVX512;
+			if (hasAVX2 && osSavesYmm)
+				return simd::Isa::AVX2;
+			return simd::Isa::SSE41;
+		}
+
+		//-1 while nothing is forced
+		std::atomic<int> g_IsaOverride{ -1 };
+	}
+
+	simd::Isa simd::GetSupportedIsa()
+	{
+		static const Isa supportedIsa{ DetectIsa() };
+		return supportedIsa;
+	}
+
+	simd::Isa simd::GetActiveIsa()
+	{
+		const int isaOverride{ g_IsaOverride.load(std::memory_order_relaxed) };
+		if (isaOverride >= 0)
+			return static_cast<Isa>(isaOverride);
+
+		return GetSupportedIsa();
+	}
+
+	void simd::SetIsaOverride(Isa isa)
+	{
+		//A variant the CPU can't run would crash on the first kernel
+		if (isa > GetSupportedIsa())
+			isa = GetSupportedIsa();
+
+		g_IsaOverride.store(static_cast<int>(isa), std::memory_order_relaxed);
+	}
+
+	const char* simd::GetIsaName(Isa isa)
+	{
+		switch (isa)
+		{
+		case Isa::SSE2:
+			return "SSE2";
+		case Isa::SSE41:
+			return "SSE4.1";
+		case Isa::AVX2:
+			return "AVX2";
+		case Isa::AVX512:
+			return "AVX-512";
+		}
+		return "Unknown";
+	}
+
+	bool simd::ParseIsa(const char* pName, Isa& isa)
+	{
+		if (!pName)
+			return false;
+
+		for (const Isa candidate : { Isa::SSE2, Isa::SSE41, Isa::AVX2, Isa::AVX512 })
+		{
+			const char* pCandidateName{ GetIsaName(candidate) };
+
+			size_t index{};
+			while (pName[index] && pCandidateName[index]
+				&& std::tolower(static_cast<unsigned char>(pName[index])) == std::tolower(static_cast<unsigned char>(pCandidateName[index])))
+			{
+				++index;
+			}
+
+			if (!pName[index] && !pCandidateName[index])
+			{
+				isa = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+}
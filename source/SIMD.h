@@ -0,0 +1,372 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+//Instruction set this translation unit is compiled for, every variant lives in its own namespace so
+//the same kernel can be built several times (see VertexStreamsKernels.h) without clashing at link time
+#if defined(__AVX512F__)
+#define DAE_SIMD_NAMESPACE avx512
+#elif defined(__AVX2__)
+#define DAE_SIMD_NAMESPACE avx2
+#elif defined(__SSE4_1__) || defined(DAE_SIMD_SSE41)
+//MSVC has no /arch switch for SSE4.1 on x64, the variant defines DAE_SIMD_SSE41 itself
+#define DAE_SIMD_NAMESPACE sse41
+#else
+#define DAE_SIMD_NAMESPACE sse2
+#endif
+
+namespace dae
+{
+	//Thin wrapper so kernels are written once and compiled for the widest enabled instruction set
+	namespace simd
+	{
+		//Instruction sets with their own kernel variant, ordered from oldest to newest
+		enum class Isa
+		{
+			SSE2,
+			SSE41,
+			AVX2,
+			AVX512
+		};
+
+		//Newest variant the CPU and the OS support, detected with cpuid
+		Isa GetSupportedIsa();
+		//Variant the dispatched kernels use, the supported one unless overridden
+		Isa GetActiveIsa();
+		//Forces a variant (benchmarking), clamped to the supported one, call before the first kernel runs
+		void SetIsaOverride(Isa isa);
+
+		const char* GetIsaName(Isa isa);
+		//Case insensitive, accepts the names GetIsaName returns
+		bool ParseIsa(const char* pName, Isa& isa);
+
+		//Widest register of all variants, streams are padded and vertex blocks are sized to it
+		constexpr int MaxWidth{ 16 };
+
+		//Number of elements after padding count up to a whole register of any variant
+		inline size_t PaddedCount(size_t count)
+		{
+			return (count + MaxWidth - 1) / MaxWidth * MaxWidth;
+		}
+
+		inline namespace DAE_SIMD_NAMESPACE
+		{
+#if defined(__AVX512F__)
+			constexpr int Width{ 16 };
+			using Float = __m512;
+
+			inline Float Load(const float* p) { return _mm512_loadu_ps(p); }
+			inline void Store(float* p, Float v) { _mm512_storeu_ps(p, v); }
+			inline Float Set1(float v) { return _mm512_set1_ps(v); }
+
+			inline Float Add(Float a, Float b) { return _mm512_add_ps(a, b); }
+			inline Float Sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+			inline Float Mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+			inline Float Div(Float a, Float b) { return _mm512_div_ps(a, b); }
+			inline Float Sqrt(Float a) { return _mm512_sqrt_ps(a); }
+			inline Float Min(Float a, Float b) { return _mm512_min_ps(a, b); }
+			inline Float Max(Float a, Float b) { return _mm512_max_ps(a, b); }
+
+			//AVX-512F only has the bitwise operations on integers, the float versions need DQ
+			inline Float Abs(Float a)
+			{
+				return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x7fffffff)));
+			}
+			//Magnitude of the first, sign of the second
+			inline Float CopySign(Float magnitude, Float sign)
+			{
+				const __m512i signMask{ _mm512_set1_epi32(static_cast<int>(0x80000000)) };
+				return _mm512_castsi512_ps(_mm512_or_si512(_mm512_andnot_si512(signMask, _mm512_castps_si512(magnitude)),
+					_mm512_and_si512(signMask, _mm512_castps_si512(sign))));
+			}
+
+			//Widens Width 16 bit integers to floats
+			inline Float LoadUInt16(const uint16_t* p)
+			{
+				return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+			}
+			inline Float LoadInt16(const int16_t* p)
+			{
+				return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+			}
+
+			using Int = __m512i;
+			using Mask = __mmask16;
+
+			inline Mask Greater(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+			inline Mask EqualInt(Int a, Int b) { return _mm512_cmpeq_epi32_mask(a, b); }
+			//a where mask is set, b elsewhere
+			inline Float Select(Mask mask, Float a, Float b) { return _mm512_mask_blend_ps(mask, b, a); }
+
+			inline Int Set1Int(int v) { return _mm512_set1_epi32(v); }
+			inline Int AddInt(Int a, Int b) { return _mm512_add_epi32(a, b); }
+			inline Int AndInt(Int a, Int b) { return _mm512_and_si512(a, b); }
+			inline Int OrInt(Int a, Int b) { return _mm512_or_si512(a, b); }
+			inline Int ShiftLeft(Int a, int count) { return _mm512_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+			inline Int ShiftRight(Int a, int count) { return _mm512_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+
+			inline Int TruncateToInt(Float a) { return _mm512_cvttps_epi32(a); }
+			inline Int RoundToInt(Float a) { return _mm512_cvtps_epi32(a); }
+			inline Float IntToFloat(Int a) { return _mm512_cvtepi32_ps(a); }
+			inline Int AsInt(Float a) { return _mm512_castps_si512(a); }
+			inline Float AsFloat(Int a) { return _mm512_castsi512_ps(a); }
+
+			inline Int LoadInt(const uint32_t* p) { return _mm512_loadu_si512(p); }
+			inline void StoreInt(uint32_t* p, Int v) { _mm512_storeu_si512(p, v); }
+			//pBase[index] of every lane
+			inline Int GatherUInt32(const uint32_t* pBase, Int index) { return _mm512_i32gather_epi32(index, pBase, 4); }
+#elif defined(__AVX2__)
+			constexpr int Width{ 8 };
+			using Float = __m256;
+
+			inline Float Load(const float* p) { return _mm256_loadu_ps(p); }
+			inline void Store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+			inline Float Set1(float v) { return _mm256_set1_ps(v); }
+
+			inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+			inline Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+			inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+			inline Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+			inline Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+			inline Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+			inline Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+			inline Float Abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+			//Magnitude of the first, sign of the second
+			inline Float CopySign(Float magnitude, Float sign)
+			{
+				const __m256 signMask{ _mm256_set1_ps(-0.f) };
+				return _mm256_or_ps(_mm256_andnot_ps(signMask, magnitude), _mm256_and_ps(signMask, sign));
+			}
+
+			//Widens Width 16 bit integers to floats
+			inline Float LoadUInt16(const uint16_t* p)
+			{
+				return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+			}
+			inline Float LoadInt16(const int16_t* p)
+			{
+				return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+			}
+
+			using Int = __m256i;
+			using Mask = __m256;
+
+			inline Mask Greater(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			inline Mask EqualInt(Int a, Int b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+			//a where mask is set, b elsewhere
+			inline Float Select(Mask mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+
+			inline Int Set1Int(int v) { return _mm256_set1_epi32(v); }
+			inline Int AddInt(Int a, Int b) { return _mm256_add_epi32(a, b); }
+			inline Int AndInt(Int a, Int b) { return _mm256_and_si256(a, b); }
+			inline Int OrInt(Int a, Int b) { return _mm256_or_si256(a, b); }
+			inline Int ShiftLeft(Int a, int count) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+			inline Int ShiftRight(Int a, int count) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+
+			inline Int TruncateToInt(Float a) { return _mm256_cvttps_epi32(a); }
+			inline Int RoundToInt(Float a) { return _mm256_cvtps_epi32(a); }
+			inline Float IntToFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+			inline Int AsInt(Float a) { return _mm256_castps_si256(a); }
+			inline Float AsFloat(Int a) { return _mm256_castsi256_ps(a); }
+
+			inline Int LoadInt(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+			inline void StoreInt(uint32_t* p, Int v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+			//pBase[index] of every lane
+			inline Int GatherUInt32(const uint32_t* pBase, Int index) { return _mm256_i32gather_epi32(reinterpret_cast<const int*>(pBase), index, 4); }
+#else
+			constexpr int Width{ 4 };
+			using Float = __m128;
+
+			inline Float Load(const float* p) { return _mm_loadu_ps(p); }
+			inline void Store(float* p, Float v) { _mm_storeu_ps(p, v); }
+			inline Float Set1(float v) { return _mm_set1_ps(v); }
+
+			inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+			inline Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+			inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+			inline Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+			inline Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+			inline Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+			inline Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+			inline Float Abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+			//Magnitude of the first, sign of the second
+			inline Float CopySign(Float magnitude, Float sign)
+			{
+				const __m128 signMask{ _mm_set1_ps(-0.f) };
+				return _mm_or_ps(_mm_andnot_ps(signMask, magnitude), _mm_and_ps(signMask, sign));
+			}
+
+			//Widens Width 16 bit integers to floats
+			inline Float LoadUInt16(const uint16_t* p)
+			{
+				const __m128i packed{ _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)) };
+#if defined(__SSE4_1__) || defined(DAE_SIMD_SSE41)
+				return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(packed));
+#else
+				return _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+#endif
+			}
+			inline Float LoadInt16(const int16_t* p)
+			{
+				const __m128i packed{ _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)) };
+#if defined(__SSE4_1__) || defined(DAE_SIMD_SSE41)
+				return _mm_cvtepi32_ps(_mm_cvtepi16_epi32(packed));
+#else
+				return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16));
+#endif
+			}
+
+			using Int = __m128i;
+			using Mask = __m128;
+
+			inline Mask Greater(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+			inline Mask EqualInt(Int a, Int b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+			//a where mask is set, b elsewhere
+			inline Float Select(Mask mask, Float a, Float b)
+			{
+#if defined(__SSE4_1__) || defined(DAE_SIMD_SSE41)
+				return _mm_blendv_ps(b, a, mask);
+#else
+				return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+#endif
+			}
+
+			inline Int Set1Int(int v) { return _mm_set1_epi32(v); }
+			inline Int AddInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+			inline Int AndInt(Int a, Int b) { return _mm_and_si128(a, b); }
+			inline Int OrInt(Int a, Int b) { return _mm_or_si128(a, b); }
+			inline Int ShiftLeft(Int a, int count) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+			inline Int ShiftRight(Int a, int count) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+
+			inline Int TruncateToInt(Float a) { return _mm_cvttps_epi32(a); }
+			inline Int RoundToInt(Float a) { return _mm_cvtps_epi32(a); }
+			inline Float IntToFloat(Int a) { return _mm_cvtepi32_ps(a); }
+			inline Int AsInt(Float a) { return _mm_castps_si128(a); }
+			inline Float AsFloat(Int a) { return _mm_castsi128_ps(a); }
+
+			inline Int LoadInt(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+			inline void StoreInt(uint32_t* p, Int v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+			//pBase[index] of every lane, SSE has no gather so the lanes are loaded one by one
+			inline Int GatherUInt32(const uint32_t* pBase, Int index)
+			{
+				alignas(16) int32_t indices[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+				return _mm_setr_epi32(static_cast<int>(pBase[indices[0]]), static_cast<int>(pBase[indices[1]]),
+					static_cast<int>(pBase[indices[2]]), static_cast<int>(pBase[indices[3]]));
+			}
+#endif
+
+			//Matrix with every element broadcast once, row-major with row vectors (v * M)
+			struct Matrix4
+			{
+				Float m[4][4];
+			};
+
+			//Takes the plain elements (Matrix::GetElements) instead of a dae::Matrix, the kernel variants may not call its inline members
+			inline Matrix4 Broadcast(const float (&elements)[4][4])
+			{
+				Matrix4 result;
+				for (int row{}; row < 4; ++row)
+				{
+					for (int column{}; column < 4; ++column)
+					{
+						result.m[row][column] = Set1(elements[row][column]);
+					}
+				}
+				return result;
+			}
+
+			//One output column of x * row0 + y * row1 + z * row2 + row3
+			inline Float TransformPoint(const Matrix4& matrix, Float x, Float y, Float z, int column)
+			{
+				return Add(Add(Add(Mul(x, matrix.m[0][column]), Mul(y, matrix.m[1][column])), Mul(z, matrix.m[2][column])), matrix.m[3][column]);
+			}
+
+			//Same without the translation row
+			inline Float TransformVector(const Matrix4& matrix, Float x, Float y, Float z, int column)
+			{
+				return Add(Add(Mul(x, matrix.m[0][column]), Mul(y, matrix.m[1][column])), Mul(z, matrix.m[2][column]));
+			}
+
+			inline void Normalize(Float& x, Float& y, Float& z)
+			{
+				const Float magnitude{ Sqrt(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z))) };
+				x = Div(x, magnitude);
+				y = Div(y, magnitude);
+				z = Div(z, magnitude);
+			}
+
+			//Polynomial fits of log2 and exp2, Log2 expects positive normal numbers
+			//5th degree by default (error around 1e-6), IsFast uses 3rd degree fits (around 1e-4)
+			template<bool IsFast = false>
+			inline Float Log2(Float x)
+			{
+				const Int bits{ AsInt(x) };
+				const Float exponent{ Sub(IntToFloat(AndInt(ShiftRight(bits, 23), Set1Int(0xff))), Set1(127.f)) };
+				const Float mantissa{ AsFloat(OrInt(AndInt(bits, Set1Int(0x007fffff)), Set1Int(0x3f800000))) };
+
+				//log2(mantissa) / (mantissa - 1) on [1, 2)
+				Float polynomial{};
+				if constexpr (IsFast)
+				{
+					polynomial = Set1(-8.4787636e-2f);
+					polynomial = Add(Mul(polynomial, mantissa), Set1(5.7998974e-1f));
+					polynomial = Add(Mul(polynomial, mantissa), Set1(-1.5855756f));
+					polynomial = Add(Mul(polynomial, mantissa), Set1(2.5293901f));
+				}
+				else
+				{
+					polynomial = Set1(-3.4436006e-2f);
+					polynomial = Add(Mul(polynomial, mantissa), Set1(3.1821337e-1f));
+					polynomial = Add(Mul(polynomial, mantissa), Set1(-1.2315303f));
+					polynomial = Add(Mul(polynomial, mantissa), Set1(2.5988452f));
+					polynomial = Add(Mul(polynomial, mantissa), Set1(-3.3241990f));
+					polynomial = Add(Mul(polynomial, mantissa), Set1(3.1157899f));
+				}
+				return Add(Mul(polynomial, Sub(mantissa, Set1(1.f))), exponent);
+			}
+
+			template<bool IsFast = false>
+			inline Float Exp2(Float x)
+			{
+				x = Min(Max(x, Set1(-126.f)), Set1(127.f));
+
+				//Integer part straight into the exponent bits, the fraction in [0, 1) through the polynomial
+				const Int integerPart{ RoundToInt(Sub(x, Set1(0.5f))) };
+				const Float fraction{ Sub(x, IntToFloat(integerPart)) };
+				const Float scale{ AsFloat(ShiftLeft(AddInt(integerPart, Set1Int(127)), 23)) };
+
+				Float polynomial{};
+				if constexpr (IsFast)
+				{
+					polynomial = Set1(7.8024151e-2f);
+					polynomial = Add(Mul(polynomial, fraction), Set1(2.2606460e-1f));
+					polynomial = Add(Mul(polynomial, fraction), Set1(6.9583618e-1f));
+					polynomial = Add(Mul(polynomial, fraction), Set1(9.9992477e-1f));
+				}
+				else
+				{
+					polynomial = Set1(1.8775767e-3f);
+					polynomial = Add(Mul(polynomial, fraction), Set1(8.9893397e-3f));
+					polynomial = Add(Mul(polynomial, fraction), Set1(5.5826318e-2f));
+					polynomial = Add(Mul(polynomial, fraction), Set1(2.4015361e-1f));
+					polynomial = Add(Mul(polynomial, fraction), Set1(6.9315308e-1f));
+					polynomial = Add(Mul(polynomial, fraction), Set1(9.9999994e-1f));
+				}
+				return Mul(scale, polynomial);
+			}
+
+			//base^exponent for base >= 0, a zero base gives 0 or 1 for a zero exponent like std::pow
+			template<bool IsFast = false>
+			inline Float Pow(Float base, Float exponent)
+			{
+				const Float zero{ Set1(0.f) };
+				const Float power{ Exp2<IsFast>(Mul(exponent, Log2<IsFast>(Max(base, Set1(1.17549435e-38f))))) };
+				return Select(Greater(base, zero), power, Select(Greater(exponent, zero), zero, Set1(1.f)));
+			}
+		}
+	}
+}
@@ -0,0 +1,172 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+
+#include "Frustum.h"
+
+namespace dae
+{
+	namespace
+	{
+		AABB Union(const AABB& a, const AABB& b)
+		{
+			return {
+				{ std::min(a.minimum.x, b.minimum.x), std::min(a.minimum.y, b.minimum.y), std::min(a.minimum.z, b.minimum.z) },
+				{ std::max(a.maximum.x, b.maximum.x), std::max(a.maximum.y, b.maximum.y), std::max(a.maximum.z, b.maximum.z) } };
+		}
+
+		Vector3 Centroid(const AABB& box)
+		{
+			return (box.minimum + box.maximum) * 0.5f;
+		}
+	}
+
+	void SceneBVH::Build(const std::vector<AABB>& objectBounds)
+	{
+		m_ObjectBounds = objectBounds;
+		m_Nodes.clear();
+		m_ObjectIndices.resize(objectBounds.size());
+		m_LeafOfObject.resize(objectBounds.size());
+		if (objectBounds.empty())
+			return;
+
+		for (uint32_t index{}; index < m_ObjectIndices.size(); ++index)
+		{
+			m_ObjectIndices[index] = index;
+		}
+
+		//A binary tree with n leaves never needs more than 2n - 1 nodes
+		m_Nodes.reserve(2 * objectBounds.size());
+		m_Nodes.push_back({ {}, 0, 0, 0, static_cast<uint32_t>(objectBounds.size()) });
+		UpdateNodeBounds(0);
+		Subdivide(0);
+	}
+
+	void SceneBVH::UpdateObject(uint32_t objectIndex, const AABB& bounds)
+	{
+		m_ObjectBounds[objectIndex] = bounds;
+
+		uint32_t nodeIndex{ m_LeafOfObject[objectIndex] };
+		while (true)
+		{
+			UpdateNodeBounds(nodeIndex);
+			if (nodeIndex == 0)
+				break;
+
+			nodeIndex = m_Nodes[nodeIndex].parent;
+		}
+	}
+
+	void SceneBVH::Refit()
+	{
+		//Children are always stored after their parent, so walking backwards refits bottom-up
+		for (size_t nodeIndex{ m_Nodes.size() }; nodeIndex-- > 0;)
+		{
+			UpdateNodeBounds(static_cast<uint32_t>(nodeIndex));
+		}
+	}
+
+	void SceneBVH::Cull(const Frustum& frustum, std::vector<uint32_t>& visibleObjects) const
+	{
+		visibleObjects.clear();
+		if (m_Nodes.empty())
+			return;
+
+		//Median splits keep the depth at log2(objectCount), well within the fixed stack
+		uint32_t stack[m_MaxDepth]{};
+		int stackSize{};
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			const Node& node{ m_Nodes[stack[--stackSize]] };
+
+			const FrustumTest test{ frustum.Test(node.bounds) };
+			if (test == FrustumTest::Outside)
+				continue;
+
+			//Nothing below a fully visible node needs testing, take all of its objects
+			if (test == FrustumTest::Inside)
+			{
+				visibleObjects.insert(visibleObjects.end(), m_ObjectIndices.begin() + node.firstObject, m_ObjectIndices.begin() + node.firstObject + node.objectCount);
+				continue;
+			}
+
+			if (node.leftChild == 0)
+			{
+				for (uint32_t index{ node.firstObject }; index < node.firstObject + node.objectCount; ++index)
+				{
+					if (frustum.Test(m_ObjectBounds[m_ObjectIndices[index]]) != FrustumTest::Outside)
+						visibleObjects.push_back(m_ObjectIndices[index]);
+				}
+				continue;
+			}
+
+			stack[stackSize++] = node.leftChild;
+			stack[stackSize++] = node.leftChild + 1;
+		}
+	}
+
+	void SceneBVH::Subdivide(uint32_t nodeIndex)
+	{
+		const uint32_t firstObject{ m_Nodes[nodeIndex].firstObject };
+		const uint32_t objectCount{ m_Nodes[nodeIndex].objectCount };
+
+		if (objectCount <= m_MaxLeafObjects)
+		{
+			for (uint32_t index{ firstObject }; index < firstObject + objectCount; ++index)
+			{
+				m_LeafOfObject[m_ObjectIndices[index]] = nodeIndex;
+			}
+			return;
+		}
+
+		//Split at the median centroid along the longest axis of the centroid bounds
+		Vector3 centroidMin{ Centroid(m_ObjectBounds[m_ObjectIndices[firstObject]]) };
+		Vector3 centroidMax{ centroidMin };
+		for (uint32_t index{ firstObject }; index < firstObject + objectCount; ++index)
+		{
+			const Vector3 centroid{ Centroid(m_ObjectBounds[m_ObjectIndices[index]]) };
+			centroidMin = { std::min(centroidMin.x, centroid.x), std::min(centroidMin.y, centroid.y), std::min(centroidMin.z, centroid.z) };
+			centroidMax = { std::max(centroidMax.x, centroid.x), std::max(centroidMax.y, centroid.y), std::max(centroidMax.z, centroid.z) };
+		}
+
+		const Vector3 extent{ centroidMax - centroidMin };
+		int axis{ 0 };
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+
+		const auto first{ m_ObjectIndices.begin() + firstObject };
+		const uint32_t leftCount{ objectCount / 2 };
+		std::nth_element(first, first + leftCount, first + objectCount, [this, axis](uint32_t a, uint32_t b)
+			{
+				return Centroid(m_ObjectBounds[a])[axis] < Centroid(m_ObjectBounds[b])[axis];
+			});
+
+		const uint32_t leftChild{ static_cast<uint32_t>(m_Nodes.size()) };
+		m_Nodes.push_back({ {}, 0, nodeIndex, firstObject, leftCount });
+		m_Nodes.push_back({ {}, 0, nodeIndex, firstObject + leftCount, objectCount - leftCount });
+		m_Nodes[nodeIndex].leftChild = leftChild;
+
+		UpdateNodeBounds(leftChild);
+		UpdateNodeBounds(leftChild + 1);
+		Subdivide(leftChild);
+		Subdivide(leftChild + 1);
+	}
+
+	void SceneBVH::UpdateNodeBounds(uint32_t nodeIndex)
+	{
+		Node& node{ m_Nodes[nodeIndex] };
+		if (node.leftChild != 0)
+		{
+			node.bounds = Union(m_Nodes[node.leftChild].bounds, m_Nodes[node.leftChild + 1].bounds);
+			return;
+		}
+
+		node.bounds = m_ObjectBounds[m_ObjectIndices[node.firstObject]];
+		for (uint32_t index{ node.firstObject + 1 }; index < node.firstObject + node.objectCount; ++index)
+		{
+			node.bounds = Union(node.bounds, m_ObjectBounds[m_ObjectIndices[index]]);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	struct Frustum;
+
+	//Bounding volume hierarchy over the world space boxes of the scene objects
+	class SceneBVH final
+	{
+	public:
+		SceneBVH() = default;
+		~SceneBVH() = default;
+
+		SceneBVH(const SceneBVH&) = delete;
+		SceneBVH(SceneBVH&&) noexcept = delete;
+		SceneBVH& operator=(const SceneBVH&) = delete;
+		SceneBVH& operator=(SceneBVH&&) noexcept = delete;
+
+		void Build(const std::vector<AABB>& objectBounds);
+
+		//Moves one object and refits the boxes from its leaf up to the root
+		void UpdateObject(uint32_t objectIndex, const AABB& bounds);
+		//Refits every node after many objects moved, the tree topology is kept
+		void Refit();
+
+		//Appends the index of every object that is (partially) inside the frustum
+		void Cull(const Frustum& frustum, std::vector<uint32_t>& visibleObjects) const;
+
+	private:
+		struct Node
+		{
+			AABB bounds{};
+			uint32_t leftChild{}; //0 for leaves, the right child is always leftChild + 1
+			uint32_t parent{};
+			uint32_t firstObject{};
+			uint32_t objectCount{};
+		};
+
+		static constexpr uint32_t m_MaxLeafObjects{ 2 };
+		static constexpr int m_MaxDepth{ 64 };
+
+		std::vector<Node> m_Nodes{};
+		std::vector<uint32_t> m_ObjectIndices{};
+		std::vector<AABB> m_ObjectBounds{};
+		std::vector<uint32_t> m_LeafOfObject{};
+
+		void Subdivide(uint32_t nodeIndex);
+		void UpdateNodeBounds(uint32_t nodeIndex);
+	};
+}
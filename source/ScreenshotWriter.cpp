@@ -0,0 +1,75 @@
+#include "ScreenshotWriter.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "Log.h"
+
+namespace dae
+{
+	ScreenshotWriter::ScreenshotWriter()
+	{
+		m_Thread = std::thread{ &ScreenshotWriter::WorkerLoop, this };
+	}
+
+	ScreenshotWriter::~ScreenshotWriter()
+	{
+		//Screenshots that were already taken still get written
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_QueuedCondition.notify_one();
+		m_Thread.join();
+	}
+
+	void ScreenshotWriter::Save(const uint32_t* pPixels, int width, int height, const ColorFormat& colorFormat, ImageFormat imageFormat, const std::string& path)
+	{
+		Screenshot screenshot{ std::vector<uint32_t>(pPixels, pPixels + static_cast<size_t>(width) * height), width, height, colorFormat, imageFormat, path };
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_Queue.push_back(std::move(screenshot));
+		}
+		m_QueuedCondition.notify_one();
+	}
+
+	void ScreenshotWriter::WorkerLoop()
+	{
+		std::vector<uint8_t> encoded{};
+		while (true)
+		{
+			Screenshot screenshot{};
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_QueuedCondition.wait(lock, [this] { return m_IsStopping || !m_Queue.empty(); });
+				if (m_Queue.empty())
+					return;
+
+				screenshot = std::move(m_Queue.front());
+				m_Queue.pop_front();
+			}
+
+			const auto start{ std::chrono::steady_clock::now() };
+			Utils::EncodeImage(screenshot.imageFormat, screenshot.pixels.data(), screenshot.width, screenshot.height, screenshot.colorFormat, encoded);
+			const auto end{ std::chrono::steady_clock::now() };
+
+			std::ofstream file{ screenshot.path, std::ios::binary };
+			file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+
+			//One string, so the line doesn't interleave with the output of the render thread
+			std::ostringstream report{};
+			if (file.good())
+			{
+				const size_t rawSize{ screenshot.pixels.size() * 3 };
+				report << "Screenshot saved! " << screenshot.path << ": " << encoded.size() << " bytes (" << 100.f * encoded.size() / rawSize
+					<< "% of raw RGB), encoded in " << std::chrono::duration<float, std::milli>(end - start).count() << " ms\n";
+			}
+			else
+			{
+				report << "Something went wrong. Screenshot not saved! " << screenshot.path << '\n';
+			}
+			Utils::GetLogStream() << report.str() << std::flush;
+		}
+	}
+}
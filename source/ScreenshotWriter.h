@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DataTypes.h"
+#include "ImageEncoding.h"
+
+namespace dae
+{
+	//Encodes and writes screenshots on a worker thread, the render thread only copies the pixels
+	class ScreenshotWriter final
+	{
+	public:
+		ScreenshotWriter();
+		~ScreenshotWriter();
+
+		ScreenshotWriter(const ScreenshotWriter&) = delete;
+		ScreenshotWriter(ScreenshotWriter&&) noexcept = delete;
+		ScreenshotWriter& operator=(const ScreenshotWriter&) = delete;
+		ScreenshotWriter& operator=(ScreenshotWriter&&) noexcept = delete;
+
+		//Takes a snapshot of width * height pixels, the worker reports the encoding time and size once the file is written
+		void Save(const uint32_t* pPixels, int width, int height, const ColorFormat& colorFormat, ImageFormat imageFormat, const std::string& path);
+
+	private:
+		struct Screenshot
+		{
+			std::vector<uint32_t> pixels{};
+			int width{};
+			int height{};
+			ColorFormat colorFormat{};
+			ImageFormat imageFormat{};
+			std::string path{};
+		};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_QueuedCondition{};
+		std::deque<Screenshot> m_Queue{};
+		bool m_IsStopping{ false };
+
+		std::thread m_Thread{};
+
+		void WorkerLoop();
+	};
+}
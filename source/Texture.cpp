@@ -51,4 +51,10 @@ namespace dae
 		ColorRGB rgb2{ rgb.r, rgb.g, rgb.b };
 		return rgb2 / 255.0f;
 	}
+
+	TextureView Texture::GetView() const
+	{
+		const SDL_PixelFormat* pFormat{ m_pSurface->format };
+		return { m_pSurfacePixels, m_pSurface->w, m_pSurface->h, pFormat->Rshift, pFormat->Gshift, pFormat->Bshift };
+	}
 }
\ No newline at end of file
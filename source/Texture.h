@@ -7,6 +7,17 @@ namespace dae
 {
 	struct Vector2;
 
+	//Raw texels for the packet shader, every channel is 8 bit at its shift just like Sample assumes
+	struct TextureView
+	{
+		const uint32_t* pPixels{};
+		int width{};
+		int height{};
+		int redShift{};
+		int greenShift{};
+		int blueShift{};
+	};
+
 	class Texture
 	{
 	public:
@@ -14,6 +25,7 @@ namespace dae
 
 		static Texture* LoadFromFile(const std::string& path);
 		ColorRGB Sample(const Vector2& uv) const;
+		TextureView GetView() const;
 
 	private:
 		Texture(SDL_Surface* pSurface);
@@ -0,0 +1,173 @@
+#include "VertexStreams.h"
+
+#include "FrameArena.h"
+#include "VertexStreamsKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr float g_UInt16Max{ 65535.f };
+		constexpr float g_Int16Max{ 32767.f };
+
+		uint16_t QuantizeUnorm16(float value, float minimum, float range)
+		{
+			if (range <= 0.f)
+				return 0;
+
+			const float normalized{ std::clamp((value - minimum) / range, 0.f, 1.f) };
+			return static_cast<uint16_t>(std::lround(normalized * g_UInt16Max));
+		}
+
+		int16_t QuantizeSnorm16(float value)
+		{
+			return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * g_Int16Max));
+		}
+
+		//Projects the unit vector on an octahedron and unfolds the lower half over the upper one
+		void EncodeOctahedral(const Vector3& direction, int16_t& x, int16_t& y)
+		{
+			const float sum{ std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z) };
+			if (sum <= 0.f)
+			{
+				//Degenerate vectors decode as +z, like the padding lanes
+				x = 0;
+				y = 0;
+				return;
+			}
+
+			float octX{ direction.x / sum };
+			float octY{ direction.y / sum };
+			if (direction.z < 0.f)
+			{
+				const float foldedX{ (1.f - std::abs(octY)) * (octX >= 0.f ? 1.f : -1.f) };
+				const float foldedY{ (1.f - std::abs(octX)) * (octY >= 0.f ? 1.f : -1.f) };
+				octX = foldedX;
+				octY = foldedY;
+			}
+
+			x = QuantizeSnorm16(octX);
+			y = QuantizeSnorm16(octY);
+		}
+	}
+
+	void Utils::BuildVertexStreams(Mesh& mesh)
+	{
+		VertexStreams& streams{ mesh.streams };
+		streams.count = mesh.vertices.size();
+
+		//Quantization ranges
+		Vector3 minimum{};
+		Vector3 maximum{};
+		Vector2 uvMinimum{};
+		Vector2 uvMaximum{};
+		if (!mesh.vertices.empty())
+		{
+			minimum = maximum = mesh.vertices[0].position;
+			uvMinimum = uvMaximum = mesh.vertices[0].uv;
+		}
+		for (const Vertex& vertex : mesh.vertices)
+		{
+			minimum = { std::min(minimum.x, vertex.position.x), std::min(minimum.y, vertex.position.y), std::min(minimum.z, vertex.position.z) };
+			maximum = { std::max(maximum.x, vertex.position.x), std::max(maximum.y, vertex.position.y), std::max(maximum.z, vertex.position.z) };
+			uvMinimum = { std::min(uvMinimum.x, vertex.uv.x), std::min(uvMinimum.y, vertex.uv.y) };
+			uvMaximum = { std::max(uvMaximum.x, vertex.uv.x), std::max(uvMaximum.y, vertex.uv.y) };
+		}
+		const Vector3 extent{ maximum - minimum };
+		const Vector2 uvExtent{ uvMaximum - uvMinimum };
+
+		streams.positionDecodeMatrix = Matrix::CreateScale(extent / g_UInt16Max) * Matrix::CreateTranslation(minimum);
+		streams.uvScale = uvExtent / g_UInt16Max;
+		streams.uvOffset = uvMinimum;
+
+		//Padding lanes decode to a valid normal (+z) and tangent (+x) so the kernel never divides by zero
+		const size_t paddedCount{ simd::PaddedCount(streams.count) };
+		streams.positionX.assign(paddedCount, 0);
+		streams.positionY.assign(paddedCount, 0);
+		streams.positionZ.assign(paddedCount, 0);
+		streams.normalX.assign(paddedCount, 0);
+		streams.normalY.assign(paddedCount, 0);
+		streams.tangentX.assign(paddedCount, static_cast<int16_t>(g_Int16Max));
+		streams.tangentY.assign(paddedCount, 0);
+		streams.u.assign(paddedCount, 0);
+		streams.v.assign(paddedCount, 0);
+
+		for (size_t index{}; index < streams.count; ++index)
+		{
+			const Vertex& vertex{ mesh.vertices[index] };
+			streams.positionX[index] = QuantizeUnorm16(vertex.position.x, minimum.x, extent.x);
+			streams.positionY[index] = QuantizeUnorm16(vertex.position.y, minimum.y, extent.y);
+			streams.positionZ[index] = QuantizeUnorm16(vertex.position.z, minimum.z, extent.z);
+			EncodeOctahedral(vertex.normal, streams.normalX[index], streams.normalY[index]);
+			EncodeOctahedral(vertex.tangent, streams.tangentX[index], streams.tangentY[index]);
+			streams.u[index] = QuantizeUnorm16(vertex.uv.x, uvMinimum.x, uvExtent.x);
+			streams.v[index] = QuantizeUnorm16(vertex.uv.y, uvMinimum.y, uvExtent.y);
+		}
+	}
+
+	void Utils::AllocateVertexStreams(FrameArena& arena, VertexStreamsOut& out, size_t count)
+	{
+		const size_t paddedCount{ simd::PaddedCount(count) };
+		for (float** ppStream : { &out.positionX, &out.positionY, &out.positionZ, &out.positionW,
+			&out.normalX, &out.normalY, &out.normalZ, &out.tangentX, &out.tangentY, &out.tangentZ,
+			&out.viewDirectionX, &out.viewDirectionY, &out.viewDirectionZ })
+		{
+			*ppStream = arena.Allocate<float>(paddedCount, FrameArena::BlockAlignment);
+		}
+	}
+
+	//Baseline variant, built with the project wide instruction set
+	Utils::VertexKernels Utils::GetVertexKernelsSSE2()
+	{
+		return { &simd::TransformPositionStreams, &simd::TransformAttributeStreams };
+	}
+
+	namespace
+	{
+		Utils::VertexKernels GetActiveVertexKernels()
+		{
+			switch (simd::GetActiveIsa())
+			{
+			case simd::Isa::AVX512:
+				return Utils::GetVertexKernelsAVX512();
+			case simd::Isa::AVX2:
+				return Utils::GetVertexKernelsAVX2();
+			case simd::Isa::SSE41:
+				return Utils::GetVertexKernelsSSE41();
+			default:
+				return Utils::GetVertexKernelsSSE2();
+			}
+		}
+
+		Utils::VertexKernelStreams GetKernelStreams(const VertexStreams& in)
+		{
+			return { in.positionX.data(), in.positionY.data(), in.positionZ.data(),
+				in.normalX.data(), in.normalY.data(), in.tangentX.data(), in.tangentY.data() };
+		}
+	}
+
+	void Utils::TransformPositionStreams(const VertexStreams& in, size_t first, size_t count, const Matrix& worldViewProjectionMatrix,
+		VertexStreamsOut& out, size_t outFirst)
+	{
+		//Dequantization folds into the matrix, so the kernel works on the raw 16 bit values
+		float positionMatrix[4][4];
+		(in.positionDecodeMatrix * worldViewProjectionMatrix).GetElements(positionMatrix);
+		GetActiveVertexKernels().pTransformPositions(GetKernelStreams(in), first, simd::PaddedCount(count), positionMatrix, out, outFirst);
+	}
+
+	void Utils::TransformAttributeStreams(const VertexStreams& in, size_t first, size_t count, const Matrix& worldMatrix, const Vector3& cameraOrigin,
+		const uint8_t* pBlockMask, uint32_t varyings, VertexStreamsOut& out, size_t outFirst)
+	{
+		//Positions need the dequantization, directions only the plain world matrix
+		float positionMatrix[4][4];
+		(in.positionDecodeMatrix * worldMatrix).GetElements(positionMatrix);
+		float directionMatrix[4][4];
+		worldMatrix.GetElements(directionMatrix);
+		const float origin[3]{ cameraOrigin.x, cameraOrigin.y, cameraOrigin.z };
+		GetActiveVertexKernels().pTransformAttributes(GetKernelStreams(in), first, simd::PaddedCount(count), positionMatrix, directionMatrix, origin,
+			pBlockMask, varyings, out, outFirst);
+	}
+}
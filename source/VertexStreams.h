@@ -0,0 +1,49 @@
+#pragma once
+#include "DataTypes.h"
+
+namespace dae
+{
+	class FrameArena;
+
+	namespace Utils
+	{
+		//Quantizes mesh.vertices into mesh.streams, call again whenever the vertices change
+		void BuildVertexStreams(Mesh& mesh);
+
+		//Points every output stream at room for count vertices (padded to simd::MaxWidth) in the arena
+		void AllocateVertexStreams(FrameArena& arena, VertexStreamsOut& out, size_t count);
+
+		//Transforms the positions of vertices [first, first + count) several at a time (simd::Width) into out, starting at outFirst
+		//first and outFirst must be multiples of simd::MaxWidth, out has to be allocated up front
+		//Runs the kernel variant of simd::GetActiveIsa()
+		void TransformPositionStreams(const VertexStreams& in, size_t first, size_t count, const Matrix& worldViewProjectionMatrix,
+			VertexStreamsOut& out, size_t outFirst);
+
+		//Same layout as TransformPositionStreams, fills the normal, tangent and viewDirection streams that are in varyings
+		//Registers with pBlockMask[outIndex / simd::MaxWidth] == 0 are skipped, nullptr transforms everything
+		void TransformAttributeStreams(const VertexStreams& in, size_t first, size_t count, const Matrix& worldMatrix, const Vector3& cameraOrigin,
+			const uint8_t* pBlockMask, uint32_t varyings, VertexStreamsOut& out, size_t outFirst);
+	}
+
+	inline Vector4 GatherPosition(const VertexStreamsOut& out, size_t outIndex)
+	{
+		return { out.positionX[outIndex], out.positionY[outIndex], out.positionZ[outIndex], out.positionW[outIndex] };
+	}
+
+	//Rebuilds a single Vertex_Out for triangle setup, uvs are read straight from the mesh
+	//Only the attributes in varyings are gathered, the others keep their defaults
+	inline Vertex_Out GatherVertex(const VertexStreams& in, uint32_t index, const VertexStreamsOut& out, size_t outIndex, uint32_t varyings = Varyings::All)
+	{
+		Vertex_Out vertex{};
+		vertex.position = GatherPosition(out, outIndex);
+		if (varyings & Varyings::UV)
+			vertex.uv = { in.u[index] * in.uvScale.x + in.uvOffset.x, in.v[index] * in.uvScale.y + in.uvOffset.y };
+		if (varyings & Varyings::Normal)
+			vertex.normal = { out.normalX[outIndex], out.normalY[outIndex], out.normalZ[outIndex] };
+		if (varyings & Varyings::Tangent)
+			vertex.tangent = { out.tangentX[outIndex], out.tangentY[outIndex], out.tangentZ[outIndex] };
+		if (varyings & Varyings::ViewDirection)
+			vertex.viewDirection = { out.viewDirectionX[outIndex], out.viewDirectionY[outIndex], out.viewDirectionZ[outIndex] };
+		return vertex;
+	}
+}
@@ -0,0 +1,10 @@
+//Built with /arch:AVX2 (see Rasterizer.vcxproj), only called when the CPU supports AVX2
+#include "VertexStreamsKernels.h"
+
+namespace dae
+{
+	Utils::VertexKernels Utils::GetVertexKernelsAVX2()
+	{
+		return { &simd::TransformPositionStreams, &simd::TransformAttributeStreams };
+	}
+}
@@ -0,0 +1,10 @@
+//Built with /arch:AVX512 (see Rasterizer.vcxproj), only called when the CPU supports AVX-512
+#include "VertexStreamsKernels.h"
+
+namespace dae
+{
+	Utils::VertexKernels Utils::GetVertexKernelsAVX512()
+	{
+		return { &simd::TransformPositionStreams, &simd::TransformAttributeStreams };
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+//Bodies of the vertex kernels, included once per instruction set variant (VertexStreams*.cpp)
+//Each variant translation unit is compiled with its own instruction set and the dispatcher in VertexStreams.cpp picks one at runtime
+#include "DataTypes.h"
+#include "SIMD.h"
+
+namespace dae
+{
+	namespace Utils
+	{
+		//Input streams of VertexStreams as raw pointers, the kernels don't index the std::vectors themselves
+		struct VertexKernelStreams
+		{
+			const uint16_t* pPositionX{};
+			const uint16_t* pPositionY{};
+			const uint16_t* pPositionZ{};
+			const int16_t* pNormalX{};
+			const int16_t* pNormalY{};
+			const int16_t* pTangentX{};
+			const int16_t* pTangentY{};
+		};
+
+		//Entry points of one variant, the matrices are row-major elements that already include the dequantization of the positions
+		//Kernel bodies only call the simd:: wrappers of their own variant, every other inline function (Matrix members, std::vector::operator[],
+		//PaddedCount, ...) stays in the dispatcher, the linker may keep the copy of any translation unit, including one built for a newer instruction set
+		//paddedCount is a multiple of simd::MaxWidth
+		struct VertexKernels
+		{
+			void (*pTransformPositions)(const VertexKernelStreams& in, size_t first, size_t paddedCount, const float (&positionMatrix)[4][4],
+				const VertexStreamsOut& out, size_t outFirst);
+			void (*pTransformAttributes)(const VertexKernelStreams& in, size_t first, size_t paddedCount, const float (&positionMatrix)[4][4],
+				const float (&worldMatrix)[4][4], const float (&cameraOrigin)[3], const uint8_t* pBlockMask, uint32_t varyings,
+				const VertexStreamsOut& out, size_t outFirst);
+		};
+
+		VertexKernels GetVertexKernelsSSE2();
+		VertexKernels GetVertexKernelsSSE41();
+		VertexKernels GetVertexKernelsAVX2();
+		VertexKernels GetVertexKernelsAVX512();
+	}
+
+	namespace simd
+	{
+		inline namespace DAE_SIMD_NAMESPACE
+		{
+			//The input streams are padded, so the last partial register is still safe to process
+			inline void TransformPositionStreams(const Utils::VertexKernelStreams& in, size_t first, size_t paddedCount, const float (&positionMatrix)[4][4],
+				const VertexStreamsOut& out, size_t outFirst)
+			{
+				const Matrix4 wvp{ Broadcast(positionMatrix) };
+				const Float one{ Set1(1.f) };
+
+				for (size_t offset{}; offset < paddedCount; offset += Width)
+				{
+					const size_t index{ first + offset };
+					const size_t outIndex{ outFirst + offset };
+
+					const Float x{ LoadUInt16(in.pPositionX + index) };
+					const Float y{ LoadUInt16(in.pPositionY + index) };
+					const Float z{ LoadUInt16(in.pPositionZ + index) };
+
+					//Model space -> clip space, then the perspective divide
+					Float clip[4]{};
+					for (int column{}; column < 4; ++column)
+					{
+						clip[column] = TransformPoint(wvp, x, y, z, column);
+					}
+					const Float invW{ Div(one, clip[3]) };
+					Store(out.positionX + outIndex, Mul(clip[0], invW));
+					Store(out.positionY + outIndex, Mul(clip[1], invW));
+					Store(out.positionZ + outIndex, Mul(clip[2], invW));
+					Store(out.positionW + outIndex, clip[3]);
+				}
+			}
+
+			inline void TransformAttributeStreams(const Utils::VertexKernelStreams& in, size_t first, size_t paddedCount, const float (&positionMatrix)[4][4],
+				const float (&worldMatrix)[4][4], const float (&cameraOrigin)[3], const uint8_t* pBlockMask, uint32_t varyings,
+				const VertexStreamsOut& out, size_t outFirst)
+			{
+				const Matrix4 positionWorld{ Broadcast(positionMatrix) };
+				const Matrix4 world{ Broadcast(worldMatrix) };
+				const Float originX{ Set1(cameraOrigin[0]) };
+				const Float originY{ Set1(cameraOrigin[1]) };
+				const Float originZ{ Set1(cameraOrigin[2]) };
+				const Float one{ Set1(1.f) };
+				const Float zero{ Set1(0.f) };
+				const Float minusOne{ Set1(-1.f) };
+				const Float snormScale{ Set1(1.f / 32767.f) };
+
+				for (size_t offset{}; offset < paddedCount; offset += Width)
+				{
+					const size_t index{ first + offset };
+					const size_t outIndex{ outFirst + offset };
+
+					//No surviving triangle uses any vertex of this register
+					if (pBlockMask && !pBlockMask[outIndex / MaxWidth])
+						continue;
+
+					//View direction from the world space position
+					if (varyings & Varyings::ViewDirection)
+					{
+						const Float x{ LoadUInt16(in.pPositionX + index) };
+						const Float y{ LoadUInt16(in.pPositionY + index) };
+						const Float z{ LoadUInt16(in.pPositionZ + index) };
+
+						Store(out.viewDirectionX + outIndex, Sub(TransformPoint(positionWorld, x, y, z, 0), originX));
+						Store(out.viewDirectionY + outIndex, Sub(TransformPoint(positionWorld, x, y, z, 1), originY));
+						Store(out.viewDirectionZ + outIndex, Sub(TransformPoint(positionWorld, x, y, z, 2), originZ));
+					}
+
+					//Normal and tangent are decoded from the octahedron, take the 3x3 part and get normalized again
+					auto transformDirection = [&](const int16_t* pInX, const int16_t* pInY, float* pOutX, float* pOutY, float* pOutZ)
+					{
+						Float dx{ Max(Mul(LoadInt16(pInX + index), snormScale), minusOne) };
+						Float dy{ Max(Mul(LoadInt16(pInY + index), snormScale), minusOne) };
+						const Float dz{ Sub(Sub(one, Abs(dx)), Abs(dy)) };
+
+						//Fold the lower hemisphere back, no need to normalize before the final normalize
+						const Float fold{ Max(Sub(zero, dz), zero) };
+						dx = Sub(dx, CopySign(fold, dx));
+						dy = Sub(dy, CopySign(fold, dy));
+
+						Float tx{ TransformVector(world, dx, dy, dz, 0) };
+						Float ty{ TransformVector(world, dx, dy, dz, 1) };
+						Float tz{ TransformVector(world, dx, dy, dz, 2) };
+						Normalize(tx, ty, tz);
+
+						Store(pOutX + outIndex, tx);
+						Store(pOutY + outIndex, ty);
+						Store(pOutZ + outIndex, tz);
+					};
+
+					if (varyings & Varyings::Normal)
+						transformDirection(in.pNormalX, in.pNormalY, out.normalX, out.normalY, out.normalZ);
+					if (varyings & Varyings::Tangent)
+						transformDirection(in.pTangentX, in.pTangentY, out.tangentX, out.tangentY, out.tangentZ);
+				}
+			}
+		}
+	}
+}
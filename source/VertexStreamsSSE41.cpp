@@ -0,0 +1,11 @@
+//Built without an /arch switch (there is none for SSE4.1 on x64), DAE_SIMD_SSE41 enables the SSE4.1 loads
+#define DAE_SIMD_SSE41
+#include "VertexStreamsKernels.h"
+
+namespace dae
+{
+	Utils::VertexKernels Utils::GetVertexKernelsSSE41()
+	{
+		return { &simd::TransformPositionStreams, &simd::TransformAttributeStreams };
+	}
+}
@@ -1,32 +1,119 @@
 //External includes
 #include "vld.h"
 #include "SDL.h"
+#include "SDL_image.h"
 #include "SDL_surface.h"
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 //Project includes
+#include "AllocationTracker.h"
 #include "Timer.h"
+#include "JobSystem.h"
 #include "Renderer.h"
+#include "SIMD.h"
+#include "Log.h"
 
 using namespace dae;
 
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
+	IMG_Quit();
 	SDL_Quit();
 }
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//Command line: --isa <SSE2|SSE4.1|AVX2|AVX-512> forces a kernel variant for benchmarking
+	//--record <ppm|y4m|raw> [path] writes every frame, raw goes to stdout for an external encoder
+	//--screenshot <png|qoi> picks the format of the X key screenshots
+	//--threads <count> sets the threads of the job system including the main thread, --pin keeps every worker on one logical processor
+	//--track-allocations adds the C++ heap allocations to the stats, --check-allocations <frames> renders that many frames after a warm-up
+	//and exits with 1 if any of them allocated
+	//--fast-normalize renormalizes the interpolated directions with Vector3::NormalizeFast instead of the precise Normalize
+	bool isRecording{ false };
+	bool isTrackingAllocations{ false };
+	uint32_t checkFrameCount{};
+	uint32_t threadCount{};
+	bool isPinned{ false };
+	bool isFastNormalizeEnabled{ false };
+	ImageFormat screenshotFormat{ ImageFormat::PNG };
+	FrameSequenceFormat recordFormat{};
+	std::string recordPath{ "Rasterizer_Sequence" };
+	for (int index{ 1 }; index < argc; ++index)
+	{
+		if (std::strcmp(args[index], "--pin") == 0)
+			isPinned = true;
+		else if (std::strcmp(args[index], "--track-allocations") == 0)
+			isTrackingAllocations = true;
+		else if (std::strcmp(args[index], "--fast-normalize") == 0)
+			isFastNormalizeEnabled = true;
+
+		//Everything else takes a value
+		if (index + 1 >= argc)
+			break;
+
+		if (std::strcmp(args[index], "--check-allocations") == 0)
+		{
+			const long count{ std::strtol(args[index + 1], nullptr, 10) };
+			if (count > 0)
+			{
+				checkFrameCount = static_cast<uint32_t>(count);
+				isTrackingAllocations = true;
+			}
+			else
+				std::cerr << "Invalid frame count: " << args[index + 1] << std::endl;
+		}
+		else if (std::strcmp(args[index], "--threads") == 0)
+		{
+			const long count{ std::strtol(args[index + 1], nullptr, 10) };
+			if (count > 0)
+				threadCount = static_cast<uint32_t>(count);
+			else
+				std::cerr << "Invalid thread count: " << args[index + 1] << std::endl;
+		}
+		else if (std::strcmp(args[index], "--isa") == 0)
+		{
+			simd::Isa isa{};
+			if (simd::ParseIsa(args[index + 1], isa))
+				simd::SetIsaOverride(isa);
+			else
+				std::cerr << "Unknown instruction set: " << args[index + 1] << std::endl;
+		}
+		else if (std::strcmp(args[index], "--screenshot") == 0)
+		{
+			if (!Utils::ParseImageFormat(args[index + 1], screenshotFormat))
+				std::cerr << "Unknown screenshot format: " << args[index + 1] << std::endl;
+		}
+		else if (std::strcmp(args[index], "--record") == 0)
+		{
+			isRecording = FrameSequenceWriter::ParseFormat(args[index + 1], recordFormat);
+			if (!isRecording)
+				std::cerr << "Unknown frame sequence format: " << args[index + 1] << std::endl;
+			else if (index + 2 < argc && args[index + 2][0] != '-')
+				recordPath = args[index + 2];
+			else if (recordFormat == FrameSequenceFormat::Y4M)
+				recordPath += ".y4m";
+		}
+	}
+
+	//stdout carries the frames while piping raw video
+	Utils::SetLogStream(isRecording && recordFormat == FrameSequenceFormat::RawRGB ? std::cerr : std::cout);
+	std::ostream& log{ Utils::GetLogStream() };
+	log << "SIMD kernels: " << simd::GetIsaName(simd::GetActiveIsa())
+		<< " (supported: " << simd::GetIsaName(simd::GetSupportedIsa()) << ")" << std::endl;
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
+	//The first call isn't thread safe, textures load on the job system afterwards
+	IMG_Init(IMG_INIT_PNG);
 
 	const uint32_t width = 640;
 	const uint32_t height = 480;
@@ -42,7 +129,24 @@ int main(int argc, char* args[])
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	//The main thread is one of the threads, it helps while it waits
+	const auto pJobSystem = new JobSystem(threadCount, isPinned);
+	log << "Job system: " << pJobSystem->GetThreadCount() << " threads" << (pJobSystem->IsPinned() ? ", pinned" : "") << std::endl;
+	const auto pRenderer = new Renderer(pWindow, pJobSystem);
+	pRenderer->SetScreenshotFormat(screenshotFormat);
+	pRenderer->SetFastNormalize(isFastNormalizeEnabled);
+
+	if (isRecording && !pRenderer->StartFrameSequence(recordFormat, recordPath))
+		log << "Could not open the frame sequence " << recordPath << std::endl;
+
+	//The first frames still grow buffers (frame arena, scratch vectors), after that a frame shouldn't allocate
+	constexpr uint32_t warmUpFrameCount{ 30 };
+	Utils::SetAllocationTracking(isTrackingAllocations);
+	uint32_t frameIndex{};
+	AllocationCounters periodAllocations{ Utils::GetAllocationCounters() };
+	uint64_t maxFrameAllocations{};
+	AllocationCounters checkStartAllocations{};
+	AllocationCounters checkEndAllocations{};
 
 	//Start loop
 	pTimer->Start();
@@ -69,42 +173,95 @@ int main(int argc, char* args[])
 					pRenderer->ToggleNormalMap();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
 					pRenderer->SwitchShadingMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					pRenderer->SwitchSpecularPrecision();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					pRenderer->ToggleHdr();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					pRenderer->SwitchToneMapper();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+					pRenderer->SwitchDepthFormat();
 				break;
 				
 			}
 		}
 
+		const AllocationCounters frameStartAllocations{ Utils::GetAllocationCounters() };
+
 		//--------- Update ---------
 		pRenderer->Update(pTimer);
 
 		//--------- Render ---------
 		pRenderer->Render();
 
+		const AllocationCounters frameEndAllocations{ Utils::GetAllocationCounters() };
+		maxFrameAllocations = std::max(maxFrameAllocations, frameEndAllocations.count - frameStartAllocations.count);
+		++frameIndex;
+		if (checkFrameCount > 0)
+		{
+			if (frameIndex == warmUpFrameCount)
+				checkStartAllocations = frameEndAllocations;
+			else if (frameIndex == warmUpFrameCount + checkFrameCount)
+			{
+				checkEndAllocations = frameEndAllocations;
+				isLooping = false;
+			}
+		}
+
 		//--------- Timer ---------
 		pTimer->Update();
 		printTimer += pTimer->GetElapsed();
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			log << "dFPS: " << pTimer->GetdFPS();
+			if (isTrackingAllocations)
+			{
+				const AllocationCounters allocations{ Utils::GetAllocationCounters() };
+				log << ", allocations: " << allocations.count - periodAllocations.count << " (" << allocations.bytes - periodAllocations.bytes
+					<< " bytes), at most " << maxFrameAllocations << " in one frame";
+				periodAllocations = allocations;
+				maxFrameAllocations = 0;
+			}
+			log << std::endl;
 		}
 
-		//Save screenshot after full render
+		//Save screenshot after full render, the screenshot thread reports when it is written
 		if (takeScreenshot)
 		{
-			if (!pRenderer->SaveBufferToImage())
-				std::cout << "Screenshot saved!" << std::endl;
-			else
-				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
+			pRenderer->SaveBufferToImage();
 			takeScreenshot = false;
 		}
 	}
 	pTimer->Stop();
 
+	int exitCode{ 0 };
+	if (checkFrameCount > 0)
+	{
+		const uint64_t allocationCount{ checkEndAllocations.count - checkStartAllocations.count };
+		if (frameIndex < warmUpFrameCount + checkFrameCount)
+		{
+			log << "Allocation check incomplete: stopped after " << frameIndex << " of " << warmUpFrameCount + checkFrameCount << " frames" << std::endl;
+			exitCode = 1;
+		}
+		else if (allocationCount != 0)
+		{
+			log << "Allocation check failed: " << allocationCount << " allocations (" << checkEndAllocations.bytes - checkStartAllocations.bytes
+				<< " bytes) in " << checkFrameCount << " frames after " << warmUpFrameCount << " warm-up frames" << std::endl;
+			exitCode = 1;
+		}
+		else
+			log << "Allocation check passed: no allocations in " << checkFrameCount << " frames after " << warmUpFrameCount << " warm-up frames" << std::endl;
+	}
+
+	if (isRecording)
+		log << "Frame sequence: " << pRenderer->StopFrameSequence() << " frames written" << std::endl;
+
 	//Shutdown "framework"
 	delete pRenderer;
+	delete pJobSystem;
 	delete pTimer;
 
 	ShutDown(pWindow);
-	return 0;
+	return exitCode;
 }
\ No newline at end of file